@@ -0,0 +1,31 @@
+#include "benos.h"
+#include "stdlib.h"
+#include "../stdlib/src/stdio.h"
+
+// dumps the kernel heap statistics (run with any argument to list the call sites too)
+int main(int argc, char** argv) {
+    static struct heap_stats stats;
+    if (benos_heap_stats(&stats) < 0) {
+        print("heap statistics are not compiled into this kernel\n");
+        return 0;
+    }
+
+    printf("heap blocks: %i total, %i live, %i peak\n", stats.total_blocks, stats.live_blocks, stats.peak_live_blocks);
+    printf("allocations: %i live, %i total, %i frees, %i failed\n", stats.live_allocations, stats.total_allocations, stats.total_frees, stats.failed_allocations);
+    printf("free runs: %i, largest %i blocks\n", stats.free_runs, stats.largest_free_run);
+
+    if (argc < 2) {
+        return 0;
+    }
+
+    for (int i = 0; i < stats.total_callers; i++) {
+        struct heap_caller_stats* caller = &stats.callers[i];
+        printf("  %x: %i allocations, %i bytes\n", (unsigned int)caller->caller, caller->allocations, caller->bytes);
+    }
+
+    if (stats.untracked_allocations) {
+        printf("  (%i allocations from untracked call sites)\n", stats.untracked_allocations);
+    }
+
+    return 0;
+}
@@ -11,6 +11,16 @@ global benos_process_load_start:function
 global benos_process_get_args:function
 global benos_system:function
 global benos_exit:function
+global benos_heap_stats:function
+global benos_fork:function
+global benos_sbrk:function
+global benos_nice:function
+global benos_get_priority:function
+global benos_getkeyblock:function
+global benos_sleep:function
+global benos_nanosleep:function
+global benos_clock:function
+global benos_rdtsc:function
 
 ; void print(const char* fname)
 print:
@@ -32,6 +42,16 @@ benos_getkey:
     pop ebp
     ret
 
+; int benos_getkeyblock()
+; sleeps in the kernel until a key comes in
+benos_getkeyblock:
+    push ebp
+    mov ebp, esp
+    mov eax, 15 ; command getkey block
+    int 0x80
+    pop ebp
+    ret
+
 ; void benos_putchar(char c)
 benos_putchar:
     push ebp
@@ -106,4 +126,93 @@ benos_exit:
     int 0x80
     add esp, 4
     pop ebp
-    ret
\ No newline at end of file
+    ret
+
+; int benos_heap_stats(struct heap_stats* stats)
+benos_heap_stats:
+    push ebp
+    mov ebp, esp
+    mov eax, 10 ; command heap_stats (copies the kernel heap statistics)
+    push dword[ebp+8] ; variable "stats"
+    int 0x80
+    add esp, 4
+    pop ebp
+    ret
+
+; int benos_fork()
+benos_fork:
+    push ebp
+    mov ebp, esp
+    mov eax, 11 ; command fork (0 in the child, the child's id in the parent)
+    int 0x80
+    pop ebp
+    ret
+
+; void* benos_sbrk(int increment)
+benos_sbrk:
+    push ebp
+    mov ebp, esp
+    mov eax, 12 ; command sbrk (returns the old break, 0 if it can't move)
+    push dword[ebp+8] ; variable "increment"
+    int 0x80
+    add esp, 4
+    pop ebp
+    ret
+
+; int benos_nice(int increment)
+benos_nice:
+    push ebp
+    mov ebp, esp
+    mov eax, 13 ; command nice (returns the new base priority, 0 is the highest)
+    push dword[ebp+8] ; variable "increment"
+    int 0x80
+    add esp, 4
+    pop ebp
+    ret
+
+; int benos_get_priority()
+benos_get_priority:
+    push ebp
+    mov ebp, esp
+    mov eax, 14 ; command get_priority
+    int 0x80
+    pop ebp
+    ret
+
+; int benos_sleep(unsigned int ms)
+benos_sleep:
+    push ebp
+    mov ebp, esp
+    mov eax, 16 ; command sleep
+    push dword[ebp+8] ; variable "ms"
+    int 0x80
+    add esp, 4
+    pop ebp
+    ret
+
+; int benos_nanosleep(const struct timespec* req)
+benos_nanosleep:
+    push ebp
+    mov ebp, esp
+    mov eax, 17 ; command nanosleep (rounded up to whole clock ticks)
+    push dword[ebp+8] ; variable "req"
+    int 0x80
+    add esp, 4
+    pop ebp
+    ret
+
+; int benos_clock(unsigned long long* ns)
+benos_clock:
+    push ebp
+    mov ebp, esp
+    mov eax, 18 ; command clock (nanoseconds since boot)
+    push dword[ebp+8] ; variable "ns"
+    int 0x80
+    add esp, 4
+    pop ebp
+    ret
+
+; unsigned long long benos_rdtsc()
+benos_rdtsc:
+    rdtsc
+    ret
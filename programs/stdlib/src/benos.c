@@ -1,5 +1,6 @@
 #include "benos.h"
 #include "string.h"
+#include "stdlib.h"
 
 struct command_arg* benos_parse_command(const char* command, int max) {
     struct command_arg* root_command = 0;
@@ -15,7 +16,7 @@ struct command_arg* benos_parse_command(const char* command, int max) {
         goto out;
     }
 
-    root_command = benos_malloc(sizeof(struct command_arg));
+    root_command = malloc(sizeof(struct command_arg));
     if (!root_command) {
         goto out;
     }
@@ -26,7 +27,7 @@ struct command_arg* benos_parse_command(const char* command, int max) {
     struct command_arg* current = root_command;
     token = strtok(NULL, " ");
     while(token != 0) {
-        struct command_arg* new_command = benos_malloc(sizeof(struct command_arg));
+        struct command_arg* new_command = malloc(sizeof(struct command_arg));
         if (!new_command) {
             break;
         }
@@ -42,12 +43,12 @@ out:
     return root_command;
 }
 
-int benos_getkeyblock() {
-    int val = 0;
-    do {
-        val = benos_getkey();
-    } while (val == 0);
-    return val;
+void benos_free_command(struct command_arg* root_command) {
+    while (root_command) {
+        struct command_arg* next = root_command->next;
+        free(root_command);
+        root_command = next;
+    }
 }
 
 // out_while_typing (false) is mainly for password input
@@ -88,5 +89,28 @@ int benos_system_run(const char* command) {
         return -1;
     }
 
-    return benos_system(root_command_arg);;
-}
\ No newline at end of file
+    // the kernel copies the arguments onto the new program's stack
+    int res = benos_system(root_command_arg);
+    benos_free_command(root_command_arg);
+    return res;
+}
+
+// nanoseconds since boot, read from the kernel's clock page without a system call
+unsigned long long benos_clock_ns() {
+    volatile struct benos_clock_page* page = (volatile struct benos_clock_page*)BENOS_CLOCK_PAGE_ADDRESS;
+    unsigned int sequence = 0;
+    unsigned long long ns = 0;
+    do {
+        // the kernel may update the page between any two of our reads (a clock interrupt), so retry until it didn't
+        sequence = page->sequence;
+        ns = page->base_ns;
+        if (page->mult) {
+            unsigned long long cycles = benos_rdtsc() - page->base_tsc;
+            unsigned long long low = (unsigned long long)(unsigned int)cycles * page->mult + page->base_frac;
+            unsigned long long high = (unsigned long long)(unsigned int)(cycles >> 32) * page->mult;
+            ns += (high << (32 - BENOS_CLOCK_SHIFT)) + (low >> BENOS_CLOCK_SHIFT);
+        }
+    } while ((sequence & 1) || sequence != page->sequence);
+
+    return ns;
+}
@@ -14,6 +14,49 @@ struct process_args {
     char** argv;
 };
 
+#define BENOS_HEAP_STATS_MAX_CALLERS 32
+
+// same layout as the kernel's struct heap_stats
+struct heap_caller_stats {
+    void* caller;
+    unsigned int allocations;
+    unsigned int bytes;
+};
+
+struct heap_stats {
+    unsigned int total_blocks;
+    unsigned int live_blocks;
+    unsigned int peak_live_blocks;
+    unsigned int live_allocations;
+    unsigned int free_runs;
+    unsigned int largest_free_run;
+    unsigned int total_allocations;
+    unsigned int total_frees;
+    unsigned int failed_allocations;
+    unsigned int untracked_allocations;
+    unsigned int total_callers;
+    struct heap_caller_stats callers[BENOS_HEAP_STATS_MAX_CALLERS];
+};
+
+// the kernel maps its clock read only here in every process (same as BENOS_PROGRAM_VIRTUAL_CLOCK_PAGE_ADDRESS)
+#define BENOS_CLOCK_PAGE_ADDRESS 0xC8000000
+#define BENOS_CLOCK_SHIFT 24
+
+// same layout as the kernel's struct clock_page
+struct benos_clock_page {
+    unsigned int sequence;
+    unsigned int mult;
+    unsigned long long base_tsc;
+    unsigned long long base_ns;
+    unsigned int base_frac;
+};
+
+// same layout as the kernel's struct timespec
+struct timespec {
+    unsigned int tv_sec;
+    unsigned int tv_nsec;
+};
+
 void print(const char* fname);
 int benos_getkey();
 
@@ -24,9 +67,20 @@ int benos_getkeyblock();
 void benos_terminal_readline(char* out, int max, bool out_while_typing);
 void benos_process_load_start(const char* fname);
 struct command_arg* benos_parse_command(const char* command, int max);
+void benos_free_command(struct command_arg* root_command);
 void benos_process_get_args(struct process_args* args);
 int benos_system(struct command_arg* args);
 int benos_system_run(const char* command);
 void benos_exit();
+int benos_heap_stats(struct heap_stats* stats);
+int benos_fork();
+void* benos_sbrk(int increment);
+int benos_nice(int increment);
+int benos_get_priority();
+int benos_sleep(unsigned int ms);
+int benos_nanosleep(const struct timespec* req);
+int benos_clock(unsigned long long* ns);
+unsigned long long benos_rdtsc();
+unsigned long long benos_clock_ns();
 
 #endif
\ No newline at end of file
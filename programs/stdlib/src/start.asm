@@ -6,7 +6,12 @@ extern benos_exit
 
 section .asm
 
+; the kernel starts us with argc at the stack pointer and argv right above it (sysv i386)
 _start:
+    lea eax, [esp+4]
+    push eax ; argv
+    push dword[esp+4] ; argc
     call c_start
+    add esp, 8
     call benos_exit
     ret
\ No newline at end of file
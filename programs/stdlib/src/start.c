@@ -2,11 +2,8 @@
 
 extern int main(int argc, char** argv);
 
-void c_start() {
-    struct process_args args;
-    benos_process_get_args(&args);
-
-    int res = main(args.argc, args.argv);
+void c_start(int argc, char** argv) {
+    int res = main(argc, argv);
 
     if (res == 0) {
 
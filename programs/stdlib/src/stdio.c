@@ -8,6 +8,16 @@ int putchar(int c) {
     return 0;
 }
 
+static void print_hex(unsigned int val) {
+    char text[9];
+    for (int i = 7; i >= 0; i--) {
+        text[i] = "0123456789abcdef"[val & 0xf];
+        val >>= 4;
+    }
+    text[8] = 0;
+    print(text);
+}
+
 int printf(const char* fmt, ...) {
     va_list args;
     const char* p;
@@ -30,6 +40,9 @@ int printf(const char* fmt, ...) {
                 sval = va_arg(args, char*);
                 print(sval);
                 break;
+            case 'x':
+                print_hex(va_arg(args, unsigned int));
+                break;
             default:
                 putchar(*p);
                 break;
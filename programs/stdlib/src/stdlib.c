@@ -1,5 +1,30 @@
 #include "stdlib.h"
 #include "benos.h"
+#include "memory.h"
+
+// every request is rounded up to a power of two size class with its own free list, new blocks are carved
+// out of memory taken from the program break, so most mallocs never enter the kernel
+#define MALLOC_MIN_CLASS_SHIFT 4
+#define MALLOC_MAX_CLASS_SHIFT 28
+#define MALLOC_TOTAL_CLASSES (MALLOC_MAX_CLASS_SHIFT - MALLOC_MIN_CLASS_SHIFT + 1)
+#define MALLOC_MAX_SIZE (1 << MALLOC_MAX_CLASS_SHIFT)
+// the break moves in steps this big
+#define MALLOC_ARENA_GROW (64 * 1024)
+
+// sits right before every block handed out, keeps the blocks 8 byte aligned
+struct malloc_block {
+    // usable bytes behind the header (the class size)
+    size_t size;
+
+    // next block of the same free list, only used while the block is free
+    struct malloc_block* next;
+};
+
+static struct malloc_block* malloc_free[MALLOC_TOTAL_CLASSES];
+
+// part of the memory taken from the program break that was never handed out
+static char* malloc_arena = 0;
+static char* malloc_arena_end = 0;
 
 char* itoa(int i) {
     static char text[12];
@@ -28,9 +53,108 @@ char* itoa(int i) {
     return &text[loc];
 }
 
+static int malloc_class(size_t size) {
+    int class = 0;
+    while (((size_t)1 << (MALLOC_MIN_CLASS_SHIFT + class)) < size) {
+        class++;
+    }
+
+    return class;
+}
+
+static size_t malloc_class_size(int class) {
+    return (size_t)1 << (MALLOC_MIN_CLASS_SHIFT + class);
+}
+
+// takes size bytes off the arena, moving the break when the arena runs out
+static void* malloc_arena_take(size_t size) {
+    if ((size_t)(malloc_arena_end - malloc_arena) < size) {
+        size_t grow = (size + MALLOC_ARENA_GROW - 1) / MALLOC_ARENA_GROW * MALLOC_ARENA_GROW;
+        char* mem = benos_sbrk(grow);
+        if (!mem) {
+            return 0;
+        }
+
+        // someone else moved the break, the rest of the old arena is lost
+        if (mem != malloc_arena_end) {
+            malloc_arena = mem;
+        }
+
+        malloc_arena_end = mem + grow;
+    }
+
+    void* ptr = malloc_arena;
+    malloc_arena += size;
+    return ptr;
+}
+
 void* malloc(size_t size) {
-    return benos_malloc(size);
+    if (size > MALLOC_MAX_SIZE) {
+        return 0;
+    }
+
+    int class = malloc_class(size);
+    struct malloc_block* block = malloc_free[class];
+    if (block) {
+        malloc_free[class] = block->next;
+        return block + 1;
+    }
+
+    block = malloc_arena_take(sizeof(struct malloc_block) + malloc_class_size(class));
+    if (!block) {
+        return 0;
+    }
+
+    block->size = malloc_class_size(class);
+    return block + 1;
 }
+
 void free(void* ptr) {
-    benos_free(ptr);
+    if (!ptr) {
+        return;
+    }
+
+    struct malloc_block* block = (struct malloc_block*)ptr - 1;
+    int class = malloc_class(block->size);
+    block->next = malloc_free[class];
+    malloc_free[class] = block;
+}
+
+void* realloc(void* ptr, size_t size) {
+    if (!ptr) {
+        return malloc(size);
+    }
+
+    if (!size) {
+        free(ptr);
+        return 0;
+    }
+
+    struct malloc_block* block = (struct malloc_block*)ptr - 1;
+    if (size <= block->size) {
+        return ptr;
+    }
+
+    void* new_ptr = malloc(size);
+    if (!new_ptr) {
+        return 0;
+    }
+
+    memcpy(new_ptr, ptr, block->size);
+    free(ptr);
+    return new_ptr;
+}
+
+void* calloc(size_t nmemb, size_t size) {
+    if (size && nmemb > MALLOC_MAX_SIZE / size) {
+        return 0;
+    }
+
+    // recycled blocks aren't zero
+    void* ptr = malloc(nmemb * size);
+    if (ptr) {
+        memset(ptr, 0, nmemb * size);
+    }
+
+    return ptr;
 }
\ No newline at end of file
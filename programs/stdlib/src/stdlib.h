@@ -4,6 +4,8 @@
 
 void* malloc(size_t size);
 void free(void* ptr);
+void* realloc(void* ptr, size_t size);
+void* calloc(size_t nmemb, size_t size);
 char* itoa(int i);
 
 #endif
\ No newline at end of file
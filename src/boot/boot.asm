@@ -4,6 +4,11 @@ BITS 16
 CODE_SEG equ gdt_code - gdt_start ; sets offset of code segment (0x8)
 DATA_SEG equ gdt_data - gdt_start ; sets offset of data segment (0x10)
 
+; must match BENOS_E820_MAP_ADDRESS and BENOS_E820_MAX_ENTRIES in config.h
+E820_MAP equ 0x500 ; entry count (dword), entries start 8 bytes later
+E820_MAX_ENTRIES equ 32
+E820_SIGNATURE equ 0x534D4150 ; "SMAP"
+
 
 jmp short start
 nop
@@ -44,6 +49,30 @@ step2:
     mov sp, 0x7c00
     sti ; enable interrupts
 
+; ask the bios for the memory map (int 0x15, eax=0xE820) while we still can
+.load_memory_map:
+    mov di, E820_MAP + 8 ; es:di = where the bios writes the next entry
+    xor ebx, ebx ; continuation value, 0 for the first entry
+    xor bp, bp ; number of entries
+.next_memory_map_entry:
+    mov eax, 0xE820
+    mov ecx, 24 ; size of one entry
+    mov edx, E820_SIGNATURE
+    mov dword [es:di+20], 1 ; acpi attributes, valid unless the bios says otherwise
+    int 0x15
+    jc .memory_map_done ; not supported or past the last entry
+    cmp eax, E820_SIGNATURE
+    jne .memory_map_done
+    inc bp
+    add di, 24
+    cmp bp, E820_MAX_ENTRIES
+    je .memory_map_done
+    test ebx, ebx ; 0 means that was the last entry
+    jnz .next_memory_map_entry
+.memory_map_done:
+    mov [E820_MAP], bp
+    mov word [E820_MAP + 2], 0
+
 .load_protected:
     cli
     lgdt[gdt_descriptor] ; load GDT
@@ -89,7 +118,10 @@ gdt_descriptor:
 ; writing our loading driver 
 load32:
     mov eax, 1 ; starting sector
-    mov ecx, 100 ; number of sectors to read
+%ifndef KERNEL_SECTORS
+%error "KERNEL_SECTORS isn't set, the Makefile passes it"
+%endif
+    mov ecx, KERNEL_SECTORS ; number of sectors to read (the ata sector count register is 8 bits, so at most 255)
     mov edi, 0x0100000 ; destination address to load sectors into
     call ata_lba_read
     jmp CODE_SEG:0x0100000 ; jump to loaded sectors
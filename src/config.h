@@ -6,11 +6,32 @@
 
 #define BENOS_TOTAL_INTERRUPTS 512
 
-// 100MB heap size
-#define BENOS_HEAP_SIZE_BYTES 104857600
-#define BENOS_HEAP_BLOCK_SIZE 4096
+// the usable ram from BENOS_HEAD_ADDRESS on is split between the kernel heap and the page frames
 #define BENOS_HEAD_ADDRESS 0x01000000
-#define BENOS_HEAP_TABLE_ADDRESS 0x00007E00
+// assumed size of that ram when the bios has no memory map (100MB)
+#define BENOS_FALLBACK_RAM_BYTES 104857600
+
+// the kernel heap gets a quarter of it (at most 256MB), the page frame allocator the rest
+#define BENOS_HEAP_RAM_DIVISOR 4
+#define BENOS_HEAP_MAX_BYTES 268435456
+#define BENOS_HEAP_BLOCK_SIZE 4096
+
+// frames kept zeroed ahead of time for frame_zalloc (1MB)
+#define BENOS_ZERO_FRAME_POOL_SIZE 256
+// frames zeroed per idle refill, small so a key press isn't held up
+#define BENOS_ZERO_FRAME_REFILL_BATCH 8
+
+// the kernel only uses ram below 2GB, the upper half of the address space is left for devices
+#define BENOS_KERNEL_MEMORY_LIMIT 0x80000000
+
+// boot.asm stores the bios memory map here (keep in sync with boot.asm)
+#define BENOS_E820_MAP_ADDRESS 0x500
+#define BENOS_E820_MAX_ENTRIES 32
+
+// set to 1 for heap accounting (debug builds), it costs every kmalloc a walk of the callers table
+#define BENOS_HEAP_STATS 0
+// distinct kmalloc call sites tracked by the heap statistics
+#define BENOS_HEAP_STATS_MAX_CALLERS 32
 
 #define BENOS_SECTOR_SIZE 512
 
@@ -21,19 +42,56 @@
 
 #define BENOS_TOTAL_GDT_SEGMENTS 6
 
+// stack the cpu switches to when a task is interrupted (tss.esp0), kept below the program window
+#define BENOS_KERNEL_INTERRUPT_STACK_ADDRESS 0x300000
+
 #define BENOS_PROGRAM_VIRTUAL_ADDRESS 0x400000
-// all tasks share the same stack (its ok because they still have different page directories which point to different physical addresses)
-#define BENOS_USER_PROGRAM_STACK_SIZE 1024 * 16
-#define BENOS_PROGRAM_VIRTUAL_STACK_ADDRESS_START 0x3FF000
-#define BENOS_PROGRAM_VIRTUAL_STACK_ADDRESS_END BENOS_PROGRAM_VIRTUAL_STACK_ADDRESS_START - BENOS_USER_PROGRAM_STACK_SIZE
 
 #define USER_DATA_SEGMENT 0x23
 #define USER_CODE_SEGMENT 0x1B
 
-#define BENOS_MAX_PROGRAM_ALLOCATIONS 1024
+// elf images kept loaded (and shared between instances of the same program)
+#define BENOS_ELF_CACHE_MAX_FILES 8
+
+// process_malloc hands out addresses from here, above all the ram the kernel uses, frames are only mapped on first touch
+#define BENOS_PROGRAM_VIRTUAL_HEAP_ADDRESS BENOS_KERNEL_MEMORY_LIMIT
+#define BENOS_PROGRAM_VIRTUAL_HEAP_SIZE 0x40000000
+// the start of the heap window belongs to the program break (sbrk), process_malloc hands out addresses behind it
+#define BENOS_PROGRAM_VIRTUAL_BRK_SIZE 0x20000000
+
+// all tasks share the same stack window right above the heap window (its ok because they still have different page directories which point to different physical addresses)
+#define BENOS_PROGRAM_VIRTUAL_STACK_WINDOW_SIZE 0x08000000
+#define BENOS_PROGRAM_VIRTUAL_STACK_ADDRESS_START (BENOS_PROGRAM_VIRTUAL_HEAP_ADDRESS + BENOS_PROGRAM_VIRTUAL_HEAP_SIZE + BENOS_PROGRAM_VIRTUAL_STACK_WINDOW_SIZE)
+// read only page right above the stack window where every process finds the kernel's clock (keep in sync with the stdlib's benos.h)
+#define BENOS_PROGRAM_VIRTUAL_CLOCK_PAGE_ADDRESS BENOS_PROGRAM_VIRTUAL_STACK_ADDRESS_START
+// default limit a process's stack grows to on demand, the page below the limit is never mapped (guard page), must stay below the window size
+#define BENOS_USER_PROGRAM_STACK_SIZE (1024 * 1024 * 8)
+// faults this far below the stack pointer still count as the stack growing (pushes, enter), anything lower is a wild pointer
+#define BENOS_USER_STACK_FAULT_SLACK (64 * 1024)
+// most bytes argc, argv and the argument strings may take at the top of a new stack
+#define BENOS_USER_PROGRAM_ARGS_MAX (64 * 1024)
 
 #define BENOS_MAX_PROCESSES 12
 
+// ring 0 stack of the idle task, it only ever holds an interrupt frame and the scheduler's calls
+#define BENOS_IDLE_STACK_SIZE (16 * 1024)
+
+// clock interrupts per second while more than one task wants the cpu (19 to 1193182), the pit is tickless otherwise
+#define BENOS_TIMER_HZ 100
+
+// run queue levels of the scheduler, level 0 runs first
+#define BENOS_SCHED_LEVELS 8
+// nice goes from 0 (the default) to this, a task starts at the level of its nice and sinks at most
+// BENOS_SCHED_LEVELS - BENOS_SCHED_MAX_NICE - 1 levels below it
+#define BENOS_SCHED_MAX_NICE 3
+// time slice at a task's base level in clock ticks, every level it sinks doubles it
+#define BENOS_SCHED_QUANTUM_TICKS 1
+// every task goes back to its base level this often (clock ticks)
+#define BENOS_SCHED_BOOST_TICKS 64
+
+// page directories of exited tasks kept around for the next ones
+#define BENOS_PAGING_DIRECTORY_POOL_SIZE 8
+
 #define BENOS_MAX_ISR80H_COMMANDS 1024
 
 #define BENOS_KEYBOARD_BUFFER_SIZE 1024
@@ -1,15 +1,18 @@
 #include "streamer.h"
 #include "../memory/heap/kheap.h"
+#include "../memory/heap/slab.h"
 #include "../config.h"
 #include <stdbool.h>
 
+static struct kmem_cache disk_stream_cache = {.name = "disk_stream", .size = sizeof(struct disk_stream)};
+
 struct disk_stream* diskstreamer_new(int disk_id) {
     struct disk* disk = disk_get(disk_id);
     if (!disk) {
         return 0;
     }
 
-    struct disk_stream* streamer = kzalloc(sizeof(struct disk_stream));
+    struct disk_stream* streamer = kmem_cache_zalloc(&disk_stream_cache);
     streamer->pos = 0;
     streamer->disk = disk;
     return streamer;
@@ -51,5 +54,5 @@ out:
 }
 
 void diskstreamer_close(struct disk_stream* stream) {
-    kfree(stream);
+    kmem_cache_free(&disk_stream_cache, stream);
 }
\ No newline at end of file
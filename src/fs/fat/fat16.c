@@ -5,6 +5,7 @@
 #include "disk/streamer.h"
 #include "memory/memory.h"
 #include "memory/heap/kheap.h"
+#include "memory/heap/slab.h"
 #include "../kernel.h"
 #include <stdint.h>
 
@@ -128,6 +129,9 @@ struct filesystem fat16_fs = {
     .close = fat16_close
 };
 
+static struct kmem_cache fat_item_cache = {.name = "fat_item", .size = sizeof(struct fat_item)};
+static struct kmem_cache fat_file_descriptor_cache = {.name = "fat_file_descriptor", .size = sizeof(struct fat_file_descriptor)};
+
 struct filesystem* fat16_init() {
     strcpy(fat16_fs.name, "FAT16");
     return &fat16_fs;
@@ -145,45 +149,14 @@ int fat16_sector_to_abs(struct disk* disk, int sector) {
     return sector * disk->sector_size;
 }
 
-int fat16_get_total_items_for_dir(struct disk* disk, uint32_t dir_start_sector) {
-    struct fat_dir_item item;
-    struct fat_dir_item empty_item;
-    memset(&empty_item, 0, sizeof(empty_item));
-
-    struct fat_private* fat_private = disk->fs_private;
-    int res = 0;
+// number of items in front of the end-of-directory marker
+static int fat16_count_dir_items(struct fat_dir_item* items, int max_items) {
     int i = 0;
-    int dir_start_pos = dir_start_sector * disk->sector_size;
-
-    struct disk_stream* stream = fat_private->dir_stream;
-    if (diskstreamer_seek(stream, dir_start_pos) != BENOS_ALL_OK) {
-        res = -EIO;
-        goto out;
-    }
-
-    while (1) {
-        if (diskstreamer_read(stream, &item, sizeof(item)) != BENOS_ALL_OK) {
-            res = -EIO;
-            goto out;
-        }
-
-        if (item.fname[0] == 0x00) {
-            //done
-            break;
-        }
-
-        if (item.fname[0] == 0xE5) {
-            //skip (item unused)
-            continue;
-        }
-
+    while (i < max_items && items[i].fname[0] != 0x00) {
         i++;
     }
-    
-    res = i;
 
-out:
-    return res;
+    return i;
 }
 
 int fat16_get_root_dir(struct disk* disk, struct fat_private* fat_private, struct fat_dir* dir) {
@@ -200,8 +173,6 @@ int fat16_get_root_dir(struct disk* disk, struct fat_private* fat_private, struc
         total_sectors += 1;
     }
 
-    int total_items = fat16_get_total_items_for_dir(disk, root_dir_sector_pos);
-
     dir_item = kzalloc(root_dir_size);
 
     if (!dir_item) {
@@ -223,7 +194,7 @@ int fat16_get_root_dir(struct disk* disk, struct fat_private* fat_private, struc
 
     //everything is ok, set the dir
     dir->items = dir_item;
-    dir->total = total_items;
+    dir->total = fat16_count_dir_items(dir_item, root_dir_entries);
     dir->sector_pos = root_dir_sector_pos;
     dir->ending_sector_pos = root_dir_sector_pos + (root_dir_size / disk->sector_size);
 
@@ -344,7 +315,7 @@ static int fat16_get_fat_entry(struct disk* disk, int cluster) {
     }
 
     uint32_t fat_table_position = fat16_get_first_fat_sector(private) * disk->sector_size;
-    res = diskstreamer_seek(stream, fat_table_position * (cluster * BENOS_FAT16_FAT_ENTRY_SIZE));
+    res = diskstreamer_seek(stream, fat_table_position + (cluster * BENOS_FAT16_FAT_ENTRY_SIZE));
     if (res < 0) {
         goto out;
     }
@@ -369,7 +340,7 @@ static int fat16_get_cluster_for_offset(struct disk* disk, int starting_cluster,
     int clusters_ahead = offset / size_of_cluster_bytes;
     for (int i = 0; i < clusters_ahead; i++) {
         int entry = fat16_get_fat_entry(disk, cluster_to_use);
-        if (entry == 0xFF8 || entry == 0xFFF) {
+        if (entry == 0xFF8 || entry == 0xFFF || entry >= 0xFFF8) {
             // you are at the last entry of the file
             res = -EIO;
             goto out;
@@ -465,13 +436,12 @@ void fat16_fat_item_free(struct fat_item* item) {
         kfree(item->item);
     }
 
-    kfree(item);
+    kmem_cache_free(&fat_item_cache, item);
 }
 
 struct fat_dir* fat16_load_fat_dir(struct disk* disk, struct fat_dir_item* item) {
     int res = 0;
     struct fat_dir* dir = 0;
-    struct fat_private* fat_private = disk->fs_private;
     if (!(item->attributes & FAT_FILE_SUBDIRECTORY)) {
         res = -EINVARG;
         goto out;
@@ -483,31 +453,47 @@ struct fat_dir* fat16_load_fat_dir(struct disk* disk, struct fat_dir_item* item)
         goto out;
     }
 
+    // read the directory a sector at a time until the end marker shows up
     int cluster = fat16_get_first_cluster(item);
-    int cluster_sector = fat16_cluster_to_sector(fat_private, cluster);
-    int total_items = fat16_get_total_items_for_dir(disk, cluster_sector);
-    dir->total = total_items;
-    int dir_size = dir->total * sizeof(struct fat_dir_item);
-    dir->items = kzalloc(dir_size);
-    if(!dir->items) {
-        res = -ENOMEM;
-        goto out;
-    }
+    int items_per_sector = disk->sector_size / sizeof(struct fat_dir_item);
+    int capacity = 0;
+    while (1) {
+        struct fat_dir_item* items = krealloc(dir->items, (capacity + items_per_sector) * sizeof(struct fat_dir_item));
+        if (!items) {
+            res = -ENOMEM;
+            goto out;
+        }
+        dir->items = items;
 
-    res = fat16_read_internal(disk, cluster, 0x00, dir_size, dir->items);
-    if (res != BENOS_ALL_OK) {
-        goto out;
+        res = fat16_read_internal(disk, cluster, capacity * sizeof(struct fat_dir_item), disk->sector_size, &dir->items[capacity]);
+        if (res != BENOS_ALL_OK) {
+            if (capacity == 0) {
+                goto out;
+            }
+
+            // ran off the end of the cluster chain, the directory is full
+            res = BENOS_ALL_OK;
+            break;
+        }
+
+        int found = fat16_count_dir_items(&dir->items[capacity], items_per_sector);
+        dir->total = capacity + found;
+        capacity += items_per_sector;
+        if (found < items_per_sector) {
+            break;
+        }
     }
 
 out:
     if (res != BENOS_ALL_OK) {
         fat16_free_dir(dir);
+        dir = 0;
     }
     return dir;
 }
 
 struct fat_item* fat16_new_fat_item_for_dir_item(struct disk* disk, struct fat_dir_item* item) {
-    struct fat_item* f_item = kzalloc(sizeof(struct fat_item));
+    struct fat_item* f_item = kmem_cache_zalloc(&fat_item_cache);
     if (!f_item) {
         return 0;
     }
@@ -572,7 +558,7 @@ void* fat16_open(struct disk* disk, struct path_part* path, FILE_MODE mode) {
         goto out_err;
     }
 
-    descriptor = kzalloc(sizeof(struct fat_file_descriptor));
+    descriptor = kmem_cache_zalloc(&fat_file_descriptor_cache);
     if (!descriptor) {
         err_code = -ENOMEM;
         goto out_err;
@@ -590,14 +576,14 @@ void* fat16_open(struct disk* disk, struct path_part* path, FILE_MODE mode) {
 
 out_err:
     if (descriptor) {
-        kfree(descriptor);
+        kmem_cache_free(&fat_file_descriptor_cache, descriptor);
     }
     return ERROR(err_code);
 }
 
 static void fat16_free_file_descriptor(struct fat_file_descriptor* descriptor) {
     fat16_fat_item_free(descriptor->item);
-    kfree(descriptor);
+    kmem_cache_free(&fat_file_descriptor_cache, descriptor);
 }
 
 int fat16_close(void* private) {
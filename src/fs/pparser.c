@@ -2,9 +2,11 @@
 #include "../string/string.h"
 #include "../kernel.h"
 #include "../memory/heap/kheap.h"
+#include "../memory/heap/slab.h"
 #include "../memory/memory.h"
 #include "../status.h"
 
+static struct kmem_cache path_part_cache = {.name = "path_part", .size = sizeof(struct path_part)};
 
 static int pathparser_path_valid_format(const char* fname) {
     int len = strnlen(fname, BENOS_MAX_PATH);
@@ -59,7 +61,7 @@ struct path_part* pathparser_parse_path_part(struct path_part* last_part, const
         return 0;
     }
 
-    struct path_part* part = kzalloc(sizeof(struct path_part));
+    struct path_part* part = kmem_cache_zalloc(&path_part_cache);
     part->part = path_part_str;
     part->next = 0x00;
 
@@ -75,7 +77,7 @@ void pathparser_free(struct path_root* root) {
     while (part) {
         struct path_part* next_part = part->next;
         kfree((void*)part->part);
-        kfree(part);
+        kmem_cache_free(&path_part_cache, part);
         part = next_part;
     }
 
@@ -0,0 +1,26 @@
+section .asm
+
+global clock_rdtsc
+global clock_cpu_has_tsc
+
+; uint64_t clock_rdtsc()
+; the time stamp counter counts cpu cycles since reset, edx:eax is already how a uint64_t is returned
+clock_rdtsc:
+    rdtsc
+    ret
+
+; bool clock_cpu_has_tsc()
+clock_cpu_has_tsc:
+    push ebp
+    mov ebp, esp
+    push ebx
+
+    mov eax, 1 ; cpuid leaf 1, feature flags
+    cpuid
+    mov eax, edx
+    shr eax, 4 ; edx bit 4 is tsc
+    and eax, 1
+
+    pop ebx
+    pop ebp
+    ret
@@ -0,0 +1,106 @@
+#include "clock.h"
+#include "timer.h"
+#include "../config.h"
+#include "../kernel.h"
+#include "../io/io.h"
+#include "../memory/frame.h"
+
+// monotonic nanoseconds since boot: the tsc is calibrated against the pit once, from then on the clock is the
+// tsc scaled by mult, rebased on every clock interrupt
+// the state lives in a frame that's mapped read only into every process, so reading the clock needs no system call
+
+static volatile struct clock_page* clock_page = 0;
+
+// counts the cpu cycles of CLOCK_CALIBRATE_COUNT pit counts on channel 2 (its out pin is readable, no interrupt)
+static uint32_t clock_calibrate() {
+    uint8_t gate = insb(PIT_GATE_PORT);
+    outb(PIT_GATE_PORT, (gate & ~PIT_GATE_SPEAKER) | PIT_GATE_CHANNEL2);
+
+    outb(PIT_COMMAND_PORT, PIT_COMMAND_CHANNEL2_ONESHOT);
+    outb(PIT_CHANNEL2_PORT, CLOCK_CALIBRATE_COUNT & 0xFF);
+    outb(PIT_CHANNEL2_PORT, CLOCK_CALIBRATE_COUNT >> 8);
+
+    uint64_t start = clock_rdtsc();
+    while (!(insb(PIT_GATE_PORT) & PIT_CHANNEL2_OUT)) {
+    }
+
+    uint64_t end = clock_rdtsc();
+    outb(PIT_GATE_PORT, gate);
+    return end - start;
+}
+
+// (CLOCK_CALIBRATE_NS << CLOCK_SHIFT) / cycles, by long division so there's no 64 bit divide
+static uint32_t clock_mult(uint32_t cycles) {
+    uint32_t mult = CLOCK_CALIBRATE_NS / cycles;
+    uint64_t rest = CLOCK_CALIBRATE_NS % cycles;
+    for (int i = 0; i < CLOCK_SHIFT; i++) {
+        rest <<= 1;
+        mult <<= 1;
+        if (rest >= cycles) {
+            rest -= cycles;
+            mult |= 1;
+        }
+    }
+
+    return mult;
+}
+
+// (cycles * mult + frac) >> CLOCK_SHIFT in 32 bit multiplies, the fraction left over goes to frac_out
+static uint64_t clock_cycles_to_ns(uint64_t cycles, uint32_t mult, uint32_t frac, uint32_t* frac_out) {
+    uint64_t low = (uint64_t)(uint32_t)cycles * mult + frac;
+    uint64_t high = (uint64_t)(uint32_t)(cycles >> 32) * mult;
+    if (frac_out) {
+        *frac_out = low & ((1 << CLOCK_SHIFT) - 1);
+    }
+
+    return (high << (32 - CLOCK_SHIFT)) + (low >> CLOCK_SHIFT);
+}
+
+void clock_init() {
+    clock_page = frame_zalloc();
+    if (!clock_page) {
+        panic("clock_init(): No frame for the clock page\n");
+    }
+
+    if (!clock_cpu_has_tsc()) {
+        // the clock only moves in clock ticks then
+        return;
+    }
+
+    uint32_t cycles = clock_calibrate();
+    if (!cycles) {
+        panic("clock_init(): The tsc doesn't count\n");
+    }
+
+    clock_page->mult = clock_mult(cycles);
+    clock_page->base_tsc = clock_rdtsc();
+}
+
+// moves the base up to now, called on every clock interrupt
+void clock_update() {
+    clock_page->sequence++;
+    if (clock_page->mult) {
+        uint64_t tsc = clock_rdtsc();
+        uint32_t frac = 0;
+        clock_page->base_ns += clock_cycles_to_ns(tsc - clock_page->base_tsc, clock_page->mult, clock_page->base_frac, &frac);
+        clock_page->base_frac = frac;
+        clock_page->base_tsc = tsc;
+    } else {
+        clock_page->base_ns = (uint64_t)timer_get_ticks() * TIMER_NS_PER_TICK;
+    }
+
+    clock_page->sequence++;
+}
+
+// the kernel runs with interrupts off, the page can't change under it
+uint64_t clock_ns() {
+    if (!clock_page->mult) {
+        return clock_page->base_ns;
+    }
+
+    return clock_page->base_ns + clock_cycles_to_ns(clock_rdtsc() - clock_page->base_tsc, clock_page->mult, clock_page->base_frac, 0);
+}
+
+void* clock_page_frame() {
+    return (void*)clock_page;
+}
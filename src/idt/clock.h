@@ -0,0 +1,43 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PIT_CHANNEL2_PORT 0x42
+// channel 2, low byte then high byte of the count, mode 0 (out goes high when the count runs out)
+#define PIT_COMMAND_CHANNEL2_ONESHOT 0xB0
+
+// system control port b: bit 0 gates pit channel 2, bit 1 connects it to the speaker, bit 5 reads its out pin
+#define PIT_GATE_PORT 0x61
+#define PIT_GATE_CHANNEL2 0x01
+#define PIT_GATE_SPEAKER 0x02
+#define PIT_CHANNEL2_OUT 0x20
+
+// the tsc is counted against 50ms of pit channel 2 at boot
+#define CLOCK_CALIBRATE_NS 50000000
+#define CLOCK_CALIBRATE_COUNT 59659
+
+// cycles convert to ns as (cycles * mult) >> CLOCK_SHIFT
+#define CLOCK_SHIFT 24
+
+// the page every process can read the clock from without a system call (the stdlib's struct benos_clock_page)
+// ns = base_ns + ((tsc - base_tsc) * mult + base_frac) >> CLOCK_SHIFT, mult is 0 if the cpu has no tsc
+struct clock_page {
+    // odd while the kernel updates the page, a reader retries if it changed under it
+    uint32_t sequence;
+    uint32_t mult;
+    uint64_t base_tsc;
+    uint64_t base_ns;
+    uint32_t base_frac;
+};
+
+void clock_init();
+void clock_update();
+uint64_t clock_ns();
+void* clock_page_frame();
+
+uint64_t clock_rdtsc();
+bool clock_cpu_has_tsc();
+
+#endif
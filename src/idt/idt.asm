@@ -4,12 +4,14 @@ extern int21h_handler
 extern no_interrupt_handler
 extern isr80h_handler
 extern interrupt_handler
+extern idt_page_fault
 
 global no_interrupt
 global idt_load
 global enable_interrupts
 global disable_interrupts
 global isr80h_wrapper
+global page_fault_wrapper
 global interrupt_pointer_table
 
 disable_interrupts:
@@ -62,6 +64,19 @@ no_interrupt:
 %endrep
 
 
+; the cpu pushes an error code for page faults, it's taken off first so the rest matches the interrupt frame
+page_fault_wrapper:
+    pop dword [page_fault_error]
+    pushad
+
+    push esp
+    push dword [page_fault_error]
+    call idt_page_fault
+    add esp, 8
+
+    popad
+    iret
+
 isr80h_wrapper:
     cli
     ; INTERRUPT FRAME START
@@ -88,6 +103,8 @@ isr80h_wrapper:
 section .data
 ; stores return results from isr80h_handler
 tmp_res dd 0
+; error code of the page fault being handled
+page_fault_error dd 0
 
 %macro interrupt_array_entry 1
     dd int%1
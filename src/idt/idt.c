@@ -6,6 +6,9 @@
 #include "../task/task.h"
 #include "../status.h"
 #include "../task/process.h"
+#include "../task/sched.h"
+#include "timer.h"
+#include "clock.h"
 
 
 
@@ -22,16 +25,24 @@ extern void idt_load(struct idtr_desc* ptr);
 extern void int21h();
 extern void no_interrupt();
 extern void isr80h_wrapper();
+extern void page_fault_wrapper();
 
 void no_interrupt_handler() {
     outb(0x20, 0x20);
 }
 
+// the kernel is mapped in every task's directory, so entering it only needs the kernel segments
 void interrupt_handler(int interrupt, struct interrupt_frame* frame) {
-    kernel_page();
+    kernel_registers();
     if (interrupt_callbacks[interrupt] != 0) {
         task_current_save_state(frame);
         interrupt_callbacks[interrupt](frame);
+
+        // the interrupt may have woken up a task that's more important than the one it interrupted
+        if (sched_should_preempt(task_current())) {
+            outb(0x20, 0x20);
+            task_next();
+        }
     }
 
     task_page();
@@ -51,17 +62,52 @@ void idt_set(int interrupt_num, void* address) {
     desc->offset_2 = (uint32_t) address >> 16;
 }
 
+// exceptions are only raised by the cpu, a user int instruction on them would leave no error code to pop
+static void idt_set_kernel_only(int interrupt_num, void* address) {
+    idt_set(interrupt_num, address);
+    idt_descriptors[interrupt_num].type_attr = 0x8E; // 0b10001110 interrupt gate, ring 0 only
+}
+
 void idt_handle_exception() {
+    if (!task_current()->process) {
+        panic("Exception in the idle task\n");
+    }
+
     process_terminate(task_current()->process);
     task_next();
 }
 
+// pages of the process that were reserved but never touched get their frame here, anything else is a real fault
+void idt_page_fault(uint32_t error, struct interrupt_frame* frame) {
+    void* virt = paging_fault_address();
+    struct task* task = task_current();
+
+    if (!(error & PAGING_FAULT_USER)) {
+        // the kernel reaches user memory through task_user_to_kernel, so this is a kernel bug
+        panic("Page fault in the kernel\n");
+    }
+
+    kernel_registers();
+    task_current_save_state(frame);
+    if (process_handle_page_fault(task->process, virt, error) < 0) {
+        idt_handle_exception();
+    }
+
+    task_page();
+}
+
 void idt_clock()
 {
     outb(0x20, 0x20);
-    
-    // Switch to the next task
-    task_next();
+    clock_update();
+    if (!timer_interrupt()) {
+        return;
+    }
+
+    // only switch once the time slice is used up or a more important task is waiting
+    if (sched_tick(task_current())) {
+        task_next();
+    }
 }
 
 void idt_init() {
@@ -79,6 +125,7 @@ void idt_init() {
         idt_register_interrupt_callback(i, idt_handle_exception);
     }
 
+    idt_set_kernel_only(14, page_fault_wrapper);
     idt_register_interrupt_callback(0x20, idt_clock);
 
     // load the IDT
@@ -130,7 +177,7 @@ void* isr80h_handle_command(int command, struct interrupt_frame* frame) {
 
 void* isr80h_handler(int command, struct interrupt_frame* frame) {
     void* res = 0;
-    kernel_page();
+    kernel_registers();
     task_current_save_state(frame);
     res = isr80h_handle_command(command, frame);
     task_page();
@@ -0,0 +1,253 @@
+#include "timer.h"
+#include "../config.h"
+#include "../io/io.h"
+
+// the pit's channel 0 counts down and raises irq 0 when its count runs out
+// periodic: the count reloads by itself every 1/BENOS_TIMER_HZ seconds, every interrupt is one scheduler tick
+// tickless: while no other task waits for its turn ticks are useless, the pit then counts down once as far as it
+// can (or up to the next timer) and whatever it counted so far is read back when the count is replaced early
+
+// pit counts per tick
+static uint32_t timer_period = 0;
+
+// count the pit was started with, 0 once a one shot count ran out
+static uint32_t timer_count = 0;
+static bool timer_tickless = false;
+
+// the count ran out while interrupts were off and was accounted for already, its interrupt is still coming
+static bool timer_skip_interrupt = false;
+
+// ticks since boot and the pit counts that don't make a whole tick yet
+static uint32_t timer_ticks = 0;
+static uint32_t timer_tick_counts = 0;
+
+static struct timer* timer_root[TIMER_ROOT_SIZE];
+static struct timer* timer_levels[TIMER_LEVELS][TIMER_LEVEL_SIZE];
+
+// next tick the wheel runs the timers of
+static uint32_t timer_wheel_ticks = 0;
+
+static void timer_account(uint32_t counts) {
+    timer_tick_counts += counts;
+    while (timer_tick_counts >= timer_period) {
+        timer_tick_counts -= timer_period;
+        timer_ticks++;
+    }
+}
+
+// puts the timer in the slot of the level whose range its expiry falls in
+static void timer_place(struct timer* timer) {
+    uint32_t expires = timer->expires;
+    uint32_t delta = expires - timer_wheel_ticks;
+    struct timer** slot = 0;
+    if ((int32_t)delta < 0) {
+        // already due, runs with the next tick the wheel runs
+        slot = &timer_root[timer_wheel_ticks & TIMER_ROOT_MASK];
+    } else if (delta < TIMER_ROOT_SIZE) {
+        slot = &timer_root[expires & TIMER_ROOT_MASK];
+    } else {
+        int level = 0;
+        int shift = TIMER_ROOT_BITS + TIMER_LEVEL_BITS;
+        while (level < TIMER_LEVELS - 1 && delta >= (1 << shift)) {
+            level++;
+            shift += TIMER_LEVEL_BITS;
+        }
+
+        slot = &timer_levels[level][(expires >> (shift - TIMER_LEVEL_BITS)) & TIMER_LEVEL_MASK];
+    }
+
+    timer->next = *slot;
+    if (timer->next) {
+        timer->next->pprev = &timer->next;
+    }
+
+    timer->pprev = slot;
+    *slot = timer;
+}
+
+static void timer_unlink(struct timer* timer) {
+    *timer->pprev = timer->next;
+    if (timer->next) {
+        timer->next->pprev = timer->pprev;
+    }
+
+    timer->next = 0;
+    timer->pprev = 0;
+}
+
+// spreads a slot of an upper level over the levels below, returns the slot's index
+static int timer_cascade(int level) {
+    int shift = TIMER_ROOT_BITS + level * TIMER_LEVEL_BITS;
+    int index = (timer_wheel_ticks >> shift) & TIMER_LEVEL_MASK;
+    struct timer* timer = timer_levels[level][index];
+    timer_levels[level][index] = 0;
+    while (timer) {
+        struct timer* next = timer->next;
+        timer_place(timer);
+        timer = next;
+    }
+
+    return index;
+}
+
+// runs the timers due at the wheel's tick and moves on to the next tick
+static void timer_wheel_run_tick() {
+    int index = timer_wheel_ticks & TIMER_ROOT_MASK;
+
+    // the root level went round once, the next slot of the level above comes down (and so on up)
+    if (index == 0) {
+        for (int level = 0; level < TIMER_LEVELS && timer_cascade(level) == 0; level++) {
+        }
+    }
+
+    // a timer armed by one of the functions is never due at this tick, so the loop ends
+    while (timer_root[index]) {
+        struct timer* timer = timer_root[index];
+        timer_unlink(timer);
+        timer->function(timer);
+    }
+
+    timer_wheel_ticks++;
+}
+
+// the pit counts until the next timer may be due (or the wheel has to cascade), at most PIT_MAX_ONESHOT_COUNT
+static uint32_t timer_oneshot_count() {
+    uint32_t max_ticks = PIT_MAX_ONESHOT_COUNT / timer_period + 1;
+    uint32_t ticks = 0;
+    for (uint32_t tick = timer_wheel_ticks; ticks < max_ticks; tick++, ticks++) {
+        if (timer_root[tick & TIMER_ROOT_MASK] || (tick & TIMER_ROOT_MASK) == 0) {
+            break;
+        }
+    }
+
+    // that tick ends this many ticks after the last one counted, the wheel may still be behind the count
+    int32_t ahead = (int32_t)(timer_wheel_ticks + ticks - timer_ticks);
+    if (ahead <= 0 || ahead * timer_period <= timer_tick_counts) {
+        // a timer is due already
+        return 1;
+    }
+
+    uint32_t counts = ahead * timer_period - timer_tick_counts;
+    return counts < PIT_MAX_ONESHOT_COUNT ? counts : PIT_MAX_ONESHOT_COUNT;
+}
+
+static void pit_start(uint8_t command, uint32_t count) {
+    outb(PIT_COMMAND_PORT, command);
+    outb(PIT_CHANNEL0_PORT, count & 0xFF);
+    outb(PIT_CHANNEL0_PORT, (count >> 8) & 0xFF);
+    timer_count = count;
+}
+
+static uint32_t pit_read_count() {
+    outb(PIT_COMMAND_PORT, PIT_COMMAND_LATCH);
+    uint32_t count = insb(PIT_CHANNEL0_PORT);
+    count |= insb(PIT_CHANNEL0_PORT) << 8;
+    return count;
+}
+
+static bool timer_irq_pending() {
+    outb(PIC_MASTER_COMMAND_PORT, PIC_READ_IRR);
+    return insb(PIC_MASTER_COMMAND_PORT) & 0x01;
+}
+
+// accounts the running count up to now before it's replaced
+static void timer_stop() {
+    if (!timer_count) {
+        return;
+    }
+
+    if (!timer_skip_interrupt && timer_irq_pending()) {
+        // the count ran out since the kernel was entered, only the bit past its end is lost
+        timer_account(timer_count);
+        timer_skip_interrupt = true;
+        return;
+    }
+
+    timer_account(timer_count - pit_read_count());
+}
+
+void timer_init() {
+    timer_period = PIT_INPUT_HZ / BENOS_TIMER_HZ;
+    timer_tickless = false;
+    pit_start(PIT_COMMAND_PERIODIC, timer_period);
+}
+
+// called on irq 0, true if it's a tick (false for the late interrupt of a count timer_stop already accounted for)
+bool timer_interrupt() {
+    if (timer_skip_interrupt) {
+        timer_skip_interrupt = false;
+        return false;
+    }
+
+    timer_account(timer_count);
+    if (timer_tickless) {
+        // the next count starts when the kernel returns to a task
+        timer_count = 0;
+    }
+
+    while ((int32_t)(timer_ticks - timer_wheel_ticks) >= 0) {
+        timer_wheel_run_tick();
+    }
+
+    return true;
+}
+
+// called on every return to a task, tickless while nothing else is ready
+void timer_set_tickless(bool tickless) {
+    if (tickless == timer_tickless && timer_count) {
+        return;
+    }
+
+    timer_stop();
+    timer_tickless = tickless;
+    if (tickless) {
+        pit_start(PIT_COMMAND_ONESHOT, timer_oneshot_count());
+    } else {
+        pit_start(PIT_COMMAND_PERIODIC, timer_period);
+    }
+}
+
+// ticks of 1/BENOS_TIMER_HZ seconds since boot as of the last clock interrupt or task switch, tickless stretches included
+uint32_t timer_get_ticks() {
+    return timer_ticks;
+}
+
+// clock ticks that cover at least the given time, 0 only for no time at all
+uint32_t timer_ticks_from_time(uint32_t sec, uint32_t nsec) {
+    if (sec >= TIMER_MAX_TICKS / BENOS_TIMER_HZ) {
+        return TIMER_MAX_TICKS;
+    }
+
+    return sec * BENOS_TIMER_HZ + (nsec + TIMER_NS_PER_TICK - 1) / TIMER_NS_PER_TICK;
+}
+
+// runs the timer's function once ticks whole clock ticks passed (the tick in progress doesn't count)
+void timer_add(struct timer* timer, uint32_t ticks) {
+    timer_cancel(timer);
+    if (ticks > TIMER_MAX_TICKS) {
+        ticks = TIMER_MAX_TICKS;
+    }
+
+    // a tickless count may have run for a while, the tick count has to be up to date first
+    if (timer_tickless) {
+        timer_stop();
+    }
+
+    timer->expires = timer_ticks + ticks + 1;
+    timer_place(timer);
+
+    // and the next count must not run past the new timer
+    if (timer_tickless) {
+        pit_start(PIT_COMMAND_ONESHOT, timer_oneshot_count());
+    }
+}
+
+void timer_cancel(struct timer* timer) {
+    if (timer_pending(timer)) {
+        timer_unlink(timer);
+    }
+}
+
+bool timer_pending(struct timer* timer) {
+    return timer->pprev != 0;
+}
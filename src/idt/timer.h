@@ -0,0 +1,70 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "../config.h"
+
+// the pit's input clock, every channel counts down at this rate
+#define PIT_INPUT_HZ 1193182
+
+#define PIT_CHANNEL0_PORT 0x40
+#define PIT_COMMAND_PORT 0x43
+
+// channel 0, low byte then high byte of the count
+#define PIT_COMMAND_PERIODIC 0x34 // mode 2, rate generator, reloads the count by itself
+#define PIT_COMMAND_ONESHOT 0x30 // mode 0, interrupt on terminal count, counts down once
+#define PIT_COMMAND_LATCH 0x00 // latches channel 0's count for reading
+
+// longest one shot count (~55ms), 0 would mean 65536 but reads back as 0 right after it's written
+#define PIT_MAX_ONESHOT_COUNT 0xFFFF
+
+// timer wheel: the root level has a slot per tick for the next 256 ticks, every level above has 64 slots that
+// each cover a whole turn of the level below, so the 4 upper levels reach the full 32 bit tick range
+#define TIMER_ROOT_BITS 8
+#define TIMER_LEVEL_BITS 6
+#define TIMER_ROOT_SIZE (1 << TIMER_ROOT_BITS)
+#define TIMER_LEVEL_SIZE (1 << TIMER_LEVEL_BITS)
+#define TIMER_ROOT_MASK (TIMER_ROOT_SIZE - 1)
+#define TIMER_LEVEL_MASK (TIMER_LEVEL_SIZE - 1)
+#define TIMER_LEVELS 4
+
+#define TIMER_NS_PER_TICK (1000000000 / BENOS_TIMER_HZ)
+// longest a timer can be armed for, keeps expiries well inside the signed tick comparisons (~124 days at 100hz)
+#define TIMER_MAX_TICKS 0x40000000
+
+#define PIC_MASTER_COMMAND_PORT 0x20
+// the next read of the command port returns the interrupt request register (irqs raised but not handled yet)
+#define PIC_READ_IRR 0x0A
+
+struct timer;
+typedef void (*TIMER_FUNCTION)(struct timer* timer);
+
+struct timer {
+    // tick the timer runs at
+    uint32_t expires;
+
+    // runs from the clock interrupt (interrupts off)
+    TIMER_FUNCTION function;
+    void* data;
+
+    // slot list of the wheel, pprev is 0 while the timer isn't armed
+    struct timer* next;
+    struct timer** pprev;
+};
+
+struct timespec {
+    uint32_t tv_sec;
+    uint32_t tv_nsec;
+};
+
+void timer_init();
+bool timer_interrupt();
+void timer_set_tickless(bool tickless);
+uint32_t timer_get_ticks();
+uint32_t timer_ticks_from_time(uint32_t sec, uint32_t nsec);
+void timer_add(struct timer* timer, uint32_t ticks);
+void timer_cancel(struct timer* timer);
+bool timer_pending(struct timer* timer);
+
+#endif
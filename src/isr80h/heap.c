@@ -1,6 +1,10 @@
 #include "heap.h"
 #include "../task/task.h"
 #include "../task/process.h"
+#include "../memory/heap/heap.h"
+#include "../memory/heap/kheap.h"
+#include "../kernel.h"
+#include "../status.h"
 #include <stddef.h>
 
 void* isr80h_command4_malloc(struct interrupt_frame* frame) {
@@ -12,4 +16,21 @@ void* isr80h_command5_free(struct interrupt_frame* frame) {
     void* ptr_to_free = task_get_stack_item(task_current(), 0);
     process_free(task_current()->process, ptr_to_free);
     return 0;
-}
\ No newline at end of file
+}
+
+// moves the program break, returns the old break or 0
+void* isr80h_command12_sbrk(struct interrupt_frame* frame) {
+    int increment = (int)task_get_stack_item(task_current(), 0);
+    return process_sbrk(task_current()->process, increment);
+}
+
+// fills the user's struct heap_stats with the kernel heap statistics
+void* isr80h_command10_heap_stats(struct interrupt_frame* frame) {
+    struct heap_stats stats;
+    int res = kheap_get_stats(&stats);
+    if (res < 0) {
+        return ERROR(res);
+    }
+
+    return ERROR(copy_to_user(task_current(), task_get_stack_item(task_current(), 0), &stats, sizeof(stats)));
+}
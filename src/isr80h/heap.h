@@ -4,4 +4,6 @@
 struct interrupt_frame;
 void* isr80h_command4_malloc(struct interrupt_frame* frame);
 void* isr80h_command5_free(struct interrupt_frame* frame);
+void* isr80h_command10_heap_stats(struct interrupt_frame* frame);
+void* isr80h_command12_sbrk(struct interrupt_frame* frame);
 #endif
\ No newline at end of file
@@ -1,13 +1,19 @@
 #include "io.h"
 #include "../task/task.h"
+#include "../task/process.h"
+#include "../task/sched.h"
 #include "../kernel.h"
 #include "../keyboard/keyboard.h"
+#include "../config.h"
+#include "../status.h"
 
 void* isr80h_command1_print(struct interrupt_frame* frame) {
     
     void* user_space_msg_buffer = task_get_stack_item(task_current(), 0);
     char buf[1024];
-    copy_string_from_task(task_current(), user_space_msg_buffer, buf, 1024);
+    if (strncpy_from_user(task_current(), buf, user_space_msg_buffer, sizeof(buf)) < 0) {
+        return ERROR(-EFAULT);
+    }
 
     print(buf);
     return 0;
@@ -15,6 +21,26 @@ void* isr80h_command1_print(struct interrupt_frame* frame) {
 
 void* isr80h_command2_getkey(struct interrupt_frame* frame) {
     char c = keyboard_pop();
+    if (c == 0) {
+        // the process is polling for a key, let the other tasks run
+        task_current()->registers.eax = 0;
+        sched_yield();
+    }
+    return (void*)((int)c);
+}
+
+// the int 0x80 instruction is 2 bytes (cd 80)
+#define ISR80H_INT_INSTRUCTION_SIZE 2
+
+void* isr80h_command15_getkey_block(struct interrupt_frame* frame) {
+    char c = keyboard_pop();
+    if (c == 0) {
+        // sleeps until keyboard_push wakes the process up, then runs the system call again from the start
+        // (eax still holds the command, the saved state is from the system call's entry)
+        struct task* task = task_current();
+        task->registers.ip -= ISR80H_INT_INSTRUCTION_SIZE;
+        sched_sleep(&task->process->keyboard.waiters);
+    }
     return (void*)((int)c);
 }
 
@@ -4,6 +4,8 @@
 #include "io.h"
 #include "heap.h"
 #include "process.h"
+#include "sched.h"
+#include "time.h"
 
 void isr80h_register_commands() {
     isr80h_register_command(SYSTEM_COMMAND0_SUM, isr80h_command0_sum);
@@ -16,4 +18,13 @@ void isr80h_register_commands() {
     isr80h_register_command(SYSTEM_COMMAND7_INVOKE_SYSTEM_COMMAND, isr80h_command7_invoke_system_command);
     isr80h_register_command(SYSTEM_COMMAND8_GET_PROGRAM_ARGUMENTS, isr80h_command8_get_program_arguments);
     isr80h_register_command(SYSTEM_COMMAND9_EXIT, isr80h_command9_exit);
+    isr80h_register_command(SYSTEM_COMMAND10_HEAP_STATS, isr80h_command10_heap_stats);
+    isr80h_register_command(SYSTEM_COMMAND11_FORK, isr80h_command11_fork);
+    isr80h_register_command(SYSTEM_COMMAND12_SBRK, isr80h_command12_sbrk);
+    isr80h_register_command(SYSTEM_COMMAND13_NICE, isr80h_command13_nice);
+    isr80h_register_command(SYSTEM_COMMAND14_GET_PRIORITY, isr80h_command14_get_priority);
+    isr80h_register_command(SYSTEM_COMMAND15_GETKEY_BLOCK, isr80h_command15_getkey_block);
+    isr80h_register_command(SYSTEM_COMMAND16_SLEEP, isr80h_command16_sleep);
+    isr80h_register_command(SYSTEM_COMMAND17_NANOSLEEP, isr80h_command17_nanosleep);
+    isr80h_register_command(SYSTEM_COMMAND18_CLOCK, isr80h_command18_clock);
 }
\ No newline at end of file
@@ -12,6 +12,15 @@ enum SystemCommands {
     SYSTEM_COMMAND7_INVOKE_SYSTEM_COMMAND,
     SYSTEM_COMMAND8_GET_PROGRAM_ARGUMENTS,
     SYSTEM_COMMAND9_EXIT,
+    SYSTEM_COMMAND10_HEAP_STATS,
+    SYSTEM_COMMAND11_FORK,
+    SYSTEM_COMMAND12_SBRK,
+    SYSTEM_COMMAND13_NICE,
+    SYSTEM_COMMAND14_GET_PRIORITY,
+    SYSTEM_COMMAND15_GETKEY_BLOCK,
+    SYSTEM_COMMAND16_SLEEP,
+    SYSTEM_COMMAND17_NANOSLEEP,
+    SYSTEM_COMMAND18_CLOCK,
 };
 
 void isr80h_register_commands();
@@ -5,12 +5,13 @@
 #include "../string/string.h"
 #include "../kernel.h"
 #include "../config.h"
+#include "../memory/heap/kheap.h"
 
 
 void* isr80h_command6_process_load_start(struct interrupt_frame* frame) {
     void* fname_user_ptr = task_get_stack_item(task_current(), 0);
     char fname[BENOS_MAX_PATH];
-    int res = copy_string_from_task(task_current(), fname_user_ptr, fname, sizeof(fname));
+    int res = strncpy_from_user(task_current(), fname, fname_user_ptr, sizeof(fname));
     if (res < 0) {
         goto out;
     }
@@ -32,42 +33,102 @@ out:
     return 0;
 }
 
+static void isr80h_free_command_args(struct command_arg* root_arg) {
+    while (root_arg) {
+        struct command_arg* next = root_arg->next;
+        kfree(root_arg);
+        root_arg = next;
+    }
+}
+
+// copies the caller's argument list into the kernel, its nodes can sit anywhere in the caller's memory
+static struct command_arg* isr80h_copy_command_args(struct task* task, struct command_arg* user_arg) {
+    int res = 0;
+    struct command_arg* root_arg = 0;
+    struct command_arg** link = &root_arg;
+
+    // more arguments than this can't fit the new stack anyway (and a looping list ends here)
+    int max_args = BENOS_USER_PROGRAM_ARGS_MAX / sizeof(char*);
+    for (int i = 0; user_arg; i++) {
+        if (i == max_args) {
+            res = -EINVARG;
+            goto out;
+        }
+
+        struct command_arg* arg = kzalloc(sizeof(struct command_arg));
+        if (!arg) {
+            res = -ENOMEM;
+            goto out;
+        }
+
+        *link = arg;
+        link = &arg->next;
+        res = strncpy_from_user(task, arg->arg, user_arg->arg, sizeof(arg->arg));
+        if (res < 0) {
+            goto out;
+        }
+
+        res = copy_from_user(task, &user_arg, &user_arg->next, sizeof(user_arg));
+        if (res < 0) {
+            goto out;
+        }
+    }
+
+out:
+    if (res < 0) {
+        isr80h_free_command_args(root_arg);
+        return ERROR(res);
+    }
+
+    return root_arg;
+}
+
 void* isr80h_command7_invoke_system_command(struct interrupt_frame* frame) {
-    struct command_arg* args = task_virt_addr_to_phys(task_current(), task_get_stack_item(task_current(), 0));
-    if (!args || strlen(args[0].arg) == 0) {
-        return ERROR(-EINVARG);
+    struct command_arg* root_command_arg = isr80h_copy_command_args(task_current(), task_get_stack_item(task_current(), 0));
+    if (ISERR(root_command_arg)) {
+        return root_command_arg;
+    }
+
+    int res = 0;
+    if (!root_command_arg || strlen(root_command_arg->arg) == 0) {
+        res = -EINVARG;
+        goto out;
     }
 
-    struct command_arg* root_command_arg = &args[0];
     const char* program_name = root_command_arg->arg;
 
     // kinda unoptimized to do this, but whatever
     char path[BENOS_MAX_PATH];
     strcpy(path, "0:/");
-    strncpy(path+3, program_name, sizeof(path));
+    strncpy(path+3, program_name, sizeof(path) - 3);
 
     struct process* process = 0;
-    int res = process_load_switch(path, &process);
+    res = process_load(path, &process);
     if (res < 0) {
-        return ERROR(res);
+        goto out;
     }
 
-    process_inject_args(process, root_command_arg);
+    res = process_inject_args(process, root_command_arg);
     if (res < 0) {
-        return ERROR(res);
+        process_terminate(process);
+        goto out;
     }
+
+    isr80h_free_command_args(root_command_arg);
+    process_switch(process);
     task_switch(process->task);
     task_return(&process->task->registers);
 
-    return 0;
+out:
+    isr80h_free_command_args(root_command_arg);
+    return ERROR(res);
 }
 
 void* isr80h_command8_get_program_arguments(struct interrupt_frame* frame) {
     struct process* process = task_current()->process;
-    struct process_args* args = task_virt_addr_to_phys(task_current(), task_get_stack_item(task_current(), 0));
-
-    process_get_args(process, &args->argc, &args->argv);
-    return 0;
+    struct process_args args;
+    process_get_args(process, &args.argc, &args.argv);
+    return ERROR(copy_to_user(task_current(), task_get_stack_item(task_current(), 0), &args, sizeof(args)));
 }
 
 void* isr80h_command9_exit(struct interrupt_frame* frame) {
@@ -75,4 +136,15 @@ void* isr80h_command9_exit(struct interrupt_frame* frame) {
     process_terminate(process);
     task_next();
     return 0;
+}
+
+// the parent gets the id of the child, the child gets 0
+void* isr80h_command11_fork(struct interrupt_frame* frame) {
+    struct process* child = 0;
+    int res = process_fork(task_current()->process, &child);
+    if (res < 0) {
+        return ERROR(res);
+    }
+
+    return (void*)(int)child->id;
 }
\ No newline at end of file
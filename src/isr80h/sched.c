@@ -0,0 +1,14 @@
+#include "sched.h"
+#include "../task/task.h"
+#include "../task/sched.h"
+
+// moves the base level of the calling task (positive is less important), returns the new base level
+void* isr80h_command13_nice(struct interrupt_frame* frame) {
+    int increment = (int)task_get_stack_item(task_current(), 0);
+    return (void*)sched_nice(task_current(), increment);
+}
+
+// level the calling task runs at right now
+void* isr80h_command14_get_priority(struct interrupt_frame* frame) {
+    return (void*)task_current()->priority;
+}
@@ -0,0 +1,8 @@
+#ifndef ISR80H_SCHED_H
+#define ISR80H_SCHED_H
+
+struct interrupt_frame;
+void* isr80h_command13_nice(struct interrupt_frame* frame);
+void* isr80h_command14_get_priority(struct interrupt_frame* frame);
+
+#endif
@@ -0,0 +1,44 @@
+#include "time.h"
+#include "../task/task.h"
+#include "../task/sched.h"
+#include "../idt/timer.h"
+#include "../idt/clock.h"
+#include "../kernel.h"
+#include "../status.h"
+
+// blocks the calling task for at least ticks clock ticks, the system call returns 0 once it's woken up
+static void* isr80h_sleep(uint32_t ticks) {
+    task_current()->registers.eax = 0;
+    if (!ticks) {
+        sched_yield();
+    }
+
+    sched_sleep_timeout(0, ticks);
+    return 0;
+}
+
+void* isr80h_command16_sleep(struct interrupt_frame* frame) {
+    uint32_t ms = (uint32_t)task_get_stack_item(task_current(), 0);
+    return isr80h_sleep(timer_ticks_from_time(ms / 1000, (ms % 1000) * 1000000));
+}
+
+// takes a struct timespec, the sleep is rounded up to whole clock ticks
+void* isr80h_command17_nanosleep(struct interrupt_frame* frame) {
+    struct timespec req;
+    int res = copy_from_user(task_current(), &req, task_get_stack_item(task_current(), 0), sizeof(req));
+    if (res < 0) {
+        return ERROR(res);
+    }
+
+    if (req.tv_nsec >= 1000000000) {
+        return ERROR(-EINVARG);
+    }
+
+    return isr80h_sleep(timer_ticks_from_time(req.tv_sec, req.tv_nsec));
+}
+
+// writes the nanoseconds since boot to the user's uint64_t, the clock page gives the same without a system call
+void* isr80h_command18_clock(struct interrupt_frame* frame) {
+    uint64_t ns = clock_ns();
+    return ERROR(copy_to_user(task_current(), task_get_stack_item(task_current(), 0), &ns, sizeof(ns)));
+}
@@ -0,0 +1,9 @@
+#ifndef ISR80H_TIME_H
+#define ISR80H_TIME_H
+
+struct interrupt_frame;
+void* isr80h_command16_sleep(struct interrupt_frame* frame);
+void* isr80h_command17_nanosleep(struct interrupt_frame* frame);
+void* isr80h_command18_clock(struct interrupt_frame* frame);
+
+#endif
@@ -8,6 +8,8 @@
 #include "task/process.h"
 #include "memory/heap/kheap.h"
 #include "memory/paging/paging.h"
+#include "memory/e820.h"
+#include "memory/frame.h"
 #include "isr80h/isr80h.h"
 #include "disk/disk.h"
 #include "fs/pparser.h"
@@ -19,6 +21,8 @@
 #include "task/tss.h"
 #include "status.h"
 #include "keyboard/keyboard.h"
+#include "idt/timer.h"
+#include "idt/clock.h"
 
 //a pointer to vmemory
 uint16_t* video_memory = 0;
@@ -127,9 +131,15 @@ void kernel_main() {
     // load the GDT
     gdt_load(gdt_real, sizeof(gdt_real));
 
+    // read the memory map boot.asm got from the bios
+    e820_init();
+
     // initialize the kernel heap
     kheap_init();
 
+    // the ram behind the heap is handed out as page frames
+    frame_init();
+
     // initialize the filesystem
     fs_init();
 
@@ -141,22 +151,29 @@ void kernel_main() {
 
     // setup the tss
     memset(&tss, 0x00, sizeof(tss));
-    tss.esp0 = 0x600000;
+    tss.esp0 = BENOS_KERNEL_INTERRUPT_STACK_ADDRESS;
     tss.ss0 = KERNEL_DATA_SELECTOR;
     
     // load the tss
     tss_load(0x28);
 
     // setup paging
-    kernel_chunk = paging_new_4gb(PAGING_IS_WRITABLE | PAGING_IS_PRESENT | PAGING_ACCESS_FROM_ALL);
+    // the kernel's pages are shared with every task, so users can't touch them
+    kernel_chunk = paging_new_kernel_4gb(PAGING_IS_WRITABLE | PAGING_IS_PRESENT);
     paging_4g_chunk_get_dir(kernel_chunk);
+
+    // no task maps anything over the low kernel memory or the heap, so they can stay in the tlb across task switches
+    paging_mark_global(kernel_chunk, (void*) 0x00, (void*) BENOS_PROGRAM_VIRTUAL_ADDRESS);
+    paging_mark_global(kernel_chunk, (void*) BENOS_HEAD_ADDRESS, kheap_end());
     paging_switch(kernel_chunk);
 
     /*char* ptr = kzalloc(4096);
     paging_set(paging_4g_chunk_get_dir(kernel_chunk), (void*)0x1000, (uint32_t)ptr | PAGING_IS_WRITABLE | PAGING_IS_PRESENT | PAGING_ACCESS_FROM_ALL);*/
 
-    // enable paging
+    // enable paging (the kernel map is made of 4mb pages)
+    enable_large_pages();
     enable_paging();
+    enable_global_pages();
 
     // initialize the isr80h
     isr80h_register_commands();
@@ -164,6 +181,12 @@ void kernel_main() {
     // initialize the keyboard
     keyboard_init();
 
+    // program the clock interrupt
+    timer_init();
+
+    // calibrate the tsc against the pit for the nanosecond clock
+    clock_init();
+
 
     /*
     char* ptr2 = (char*) 0x1000;
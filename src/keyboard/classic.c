@@ -56,7 +56,6 @@ uint8_t classic_keyboad_scancode_to_char(uint8_t scancode) {
 }
 
 void classic_keyboard_handle_interrupt() {
-    kernel_page();
     uint8_t scancode = 0;
     scancode = insb(KEYBOARD_INPUT_PORT);
     insb(KEYBOARD_INPUT_PORT); // ignore the second byte
@@ -76,8 +75,6 @@ void classic_keyboard_handle_interrupt() {
         // there's a character in the buffer
         keyboard_push(c);
     }
-
-    task_page();
 }
 
 struct keyboard* classic_init() {
@@ -3,6 +3,7 @@
 #include "../kernel.h"
 #include "../task/process.h"
 #include "../task/task.h"
+#include "../task/sched.h"
 #include "classic.h"
 
 static struct keyboard* keyboard_list_head = 0;
@@ -64,6 +65,9 @@ void keyboard_push(char c) {
     int real_i = keyboard_get_tail_index(proc);
     proc->keyboard.buffer[real_i] = c;
     proc->keyboard.tail++;
+
+    // interrupt_handler switches to a woken task right away if it's more important than the interrupted one
+    sched_wake_all(&proc->keyboard.waiters);
 }
 
 char keyboard_pop() {
@@ -4,6 +4,7 @@
 #include <stdbool.h>
 #include "../../memory/memory.h"
 #include "../../memory/heap/kheap.h"
+#include "../../memory/frame.h"
 #include "../../string/string.h"
 #include "../../memory/paging/paging.h"
 #include "../../kernel.h"
@@ -11,6 +12,11 @@
 #include "elf.h"
 
 const char elf_signature[] = {0x7F, 'E', 'L', 'F'};
+
+// loaded images stay here after their last process exits, so launching the same program again skips the disk
+static struct elf_file* elf_cache[BENOS_ELF_CACHE_MAX_FILES];
+static uint32_t elf_cache_clock = 0;
+
 static bool elf_valid_signature(void* buffer) {
     return memcmp(buffer, (void*) elf_signature, sizeof(elf_signature)) == 0;
 }
@@ -31,40 +37,24 @@ static bool elf_has_program_header(struct elf_header* elf_header) {
     return elf_header->e_phoff != 0;
 }
 
-void* elf_memory(struct elf_file* file) {
-    return file->elf_mem; 
-}
-
 struct elf_header* elf_header(struct elf_file* file) {
-    return file->elf_mem;
+    return &file->header;
 }
 
-struct elf32_shdr* elf_sheader(struct elf_header* header) {
-    return (struct elf32_shdr*) ((int) header + header->e_shoff);
+struct elf32_phdr* elf_pheader(struct elf_file* file) {
+    return file->phdrs;
 }
 
-struct elf32_phdr* elf_pheader(struct elf_header* header) {
-    if (header->e_phoff == 0) {
-        return 0;
-    }
-
-    return (struct elf32_phdr*)((int) header + header->e_phoff);
+struct elf32_phdr* elf_program_header(struct elf_file* file, int index) {
+    return &elf_pheader(file)[index];
 }
 
-struct elf32_phdr* elf_program_header(struct elf_header* header, int index) {
-    return &elf_pheader(header)[index];
+int elf_total_segments(struct elf_file* file) {
+    return file->total_segments;
 }
 
-struct elf32_shdr* elf_section(struct elf_header* header, int index) {
-    return &elf_sheader(header)[index];
-}
-
-void* elf_phdr_phys_address(struct elf_file* file, struct elf32_phdr* phdr) {
-    return elf_memory(file) + phdr->p_offset;
-}
-
-char* elf_str_table(struct elf_header* header) {
-    return (char*) header + elf_section(header, header->e_shstrndx)->sh_offset;
+struct elf_segment* elf_segment(struct elf_file* file, int index) {
+    return &file->segments[index];
 }
 
 void* elf_virtual_base(struct elf_file* file) {
@@ -75,14 +65,6 @@ void* elf_virtual_end(struct elf_file* file) {
     return file->virt_end_address;
 }
 
-void* elf_phys_base(struct elf_file* file) {
-    return file->phys_base_address;
-}
-
-void* elf_phys_end(struct elf_file* file) {
-    return file->phys_end_address;
-}
-
 int elf_validate_loaded(struct elf_header* elf_header) {
     return (
        elf_valid_signature(elf_header)
@@ -91,37 +73,75 @@ int elf_validate_loaded(struct elf_header* elf_header) {
     && elf_has_program_header(elf_header)) ? BENOS_ALL_OK : -EINFORMAT;
 }
 
-int elf_process_phdr_pt_load(struct elf_file* elf_file, struct elf32_phdr* phdr) {
+// reads the segment's file bytes into frames laid out like its pages, everything around them reads as zero
+static int elf_load_segment(int fd, struct elf32_phdr* phdr, struct elf_segment* segment) {
+    int res = 0;
+    segment->phdr = *phdr;
+    if (phdr->p_filesz == 0) {
+        // all bss, the process gets its pages on first touch
+        goto out;
+    }
+
+    uint32_t page_offset = phdr->p_vaddr % PAGING_PAGE_SIZE;
+    segment->total_pages = frame_size_to_frames(page_offset + phdr->p_filesz);
+    if (segment->total_pages >= PAGING_TOTAL_ENTRIES_PER_TABLE && (phdr->p_vaddr - page_offset) % PAGING_LARGE_PAGE_SIZE == 0) {
+        // lets the process map it with 4mb pages
+        segment->mem = frame_alloc_contiguous_aligned(segment->total_pages, PAGING_LARGE_PAGE_SIZE);
+    }
+
+    if (!segment->mem) {
+        segment->mem = frame_alloc_contiguous(segment->total_pages);
+    }
+
+    if (!segment->mem) {
+        res = -ENOMEM;
+        goto out;
+    }
+
+    memset(segment->mem, 0x00, page_offset);
+    memset(segment->mem + page_offset + phdr->p_filesz, 0x00, segment->total_pages * PAGING_PAGE_SIZE - page_offset - phdr->p_filesz);
+
+    res = fseek(fd, phdr->p_offset, SEEK_SET);
+    if (res < 0) {
+        goto out;
+    }
+
+    res = fread(segment->mem + page_offset, phdr->p_filesz, 1, fd);
+
+out:
+    return res < 0 ? res : 0;
+}
+
+int elf_process_phdr_pt_load(struct elf_file* elf_file, struct elf32_phdr* phdr, int fd) {
     if (elf_file->virt_base_address >= (void*) phdr->p_vaddr || elf_file->virt_base_address == 0x00) {
         elf_file->virt_base_address = (void*) phdr->p_vaddr;
-        elf_file->phys_base_address = elf_memory(elf_file) + phdr->p_offset;
     }
 
-    unsigned int end_virt_address = phdr->p_vaddr + phdr->p_filesz;
+    unsigned int end_virt_address = phdr->p_vaddr + phdr->p_memsz;
     if (elf_file->virt_end_address <= (void*)(end_virt_address) || elf_file->virt_end_address == 0x00) {
         elf_file->virt_end_address = (void*) end_virt_address;
-        elf_file->phys_end_address = elf_memory(elf_file) + phdr->p_offset + phdr->p_filesz;
     }
-    return 0;
+
+    return elf_load_segment(fd, phdr, &elf_file->segments[elf_file->total_segments++]);
 }
 
-int elf_process_pheader(struct elf_file* elf_file, struct elf32_phdr* phdr) {
+int elf_process_pheader(struct elf_file* elf_file, struct elf32_phdr* phdr, int fd) {
     int res = 0;
     switch(phdr->p_type) {
         case PT_LOAD:
-            res = elf_process_phdr_pt_load(elf_file, phdr);
+            res = elf_process_phdr_pt_load(elf_file, phdr, fd);
             break;
     }
 
     return res;
 }
 
-int elf_process_pheaders(struct elf_file* elf_file) {
+int elf_process_pheaders(struct elf_file* elf_file, int fd) {
     int res = 0;
     struct elf_header* header = elf_header(elf_file);
     for (int i = 0; i < header->e_phnum; i++) {
-        struct elf32_phdr* phdr = elf_program_header(header, i);
-        res = elf_process_pheader(elf_file, phdr);
+        struct elf32_phdr* phdr = elf_program_header(elf_file, i);
+        res = elf_process_pheader(elf_file, phdr, fd);
 
         if (res < 0) {
             break;
@@ -131,15 +151,61 @@ int elf_process_pheaders(struct elf_file* elf_file) {
     return res;
 }
 
-int elf_process_loaded(struct elf_file* elf_file) {
+// only the header, the program headers and the PT_LOAD bytes are read, sections and debug info stay on disk
+int elf_process_loaded(struct elf_file* elf_file, int fd) {
     int res = 0;
     struct elf_header* header = elf_header(elf_file);
+    res = fread(header, sizeof(struct elf_header), 1, fd);
+    if (res < 0) {
+        goto out;
+    }
+
     res = elf_validate_loaded(header);
     if (res < 0) {
         goto out;
     }
 
-    res = elf_process_pheaders(elf_file);
+    if (header->e_phentsize != sizeof(struct elf32_phdr) || header->e_phnum == 0) {
+        res = -EINFORMAT;
+        goto out;
+    }
+
+    elf_file->phdrs = kzalloc(header->e_phnum * sizeof(struct elf32_phdr));
+    if (!elf_file->phdrs) {
+        res = -ENOMEM;
+        goto out;
+    }
+
+    res = fseek(fd, header->e_phoff, SEEK_SET);
+    if (res < 0) {
+        goto out;
+    }
+
+    res = fread(elf_file->phdrs, header->e_phnum * sizeof(struct elf32_phdr), 1, fd);
+    if (res < 0) {
+        goto out;
+    }
+
+    int total_loads = 0;
+    for (int i = 0; i < header->e_phnum; i++) {
+        if (elf_file->phdrs[i].p_type == PT_LOAD) {
+            total_loads++;
+        }
+    }
+
+    if (total_loads == 0) {
+        // nothing to run
+        res = -EINFORMAT;
+        goto out;
+    }
+
+    elf_file->segments = kzalloc(total_loads * sizeof(struct elf_segment));
+    if (!elf_file->segments) {
+        res = -ENOMEM;
+        goto out;
+    }
+
+    res = elf_process_pheaders(elf_file, fd);
     if(res < 0) {
         goto out;
     }
@@ -148,41 +214,108 @@ out:
     return res;
 }
 
+static struct elf_file* elf_cache_find(const char* fname) {
+    for (int i = 0; i < BENOS_ELF_CACHE_MAX_FILES; i++) {
+        struct elf_file* file = elf_cache[i];
+        if (file && strncmp(file->fname, fname, sizeof(file->fname)) == 0) {
+            file->last_used = ++elf_cache_clock;
+            return file;
+        }
+    }
+
+    return 0;
+}
+
+// the cache holds a reference of its own, only files no process uses anymore get evicted (least recently used first)
+static void elf_cache_insert(struct elf_file* file) {
+    int slot = -1;
+    for (int i = 0; i < BENOS_ELF_CACHE_MAX_FILES; i++) {
+        struct elf_file* cached = elf_cache[i];
+        if (!cached) {
+            slot = i;
+            break;
+        }
+
+        if (cached->refcount == 1 && (slot < 0 || cached->last_used < elf_cache[slot]->last_used)) {
+            slot = i;
+        }
+    }
+
+    if (slot < 0) {
+        // every cached file is running, this one just doesn't get cached
+        return;
+    }
+
+    if (elf_cache[slot]) {
+        elf_close(elf_cache[slot]);
+    }
+
+    file->last_used = ++elf_cache_clock;
+    elf_cache[slot] = elf_ref(file);
+}
+
+static void elf_free(struct elf_file* file) {
+    for (int i = 0; i < file->total_segments; i++) {
+        if (file->segments[i].mem) {
+            frame_free_contiguous(file->segments[i].mem, file->segments[i].total_pages);
+        }
+    }
+
+    kfree(file->segments);
+    kfree(file->phdrs);
+    kfree(file);
+}
+
 int elf_load(const char* fname, struct elf_file** file_out) {
-    struct elf_file* file = kzalloc(sizeof(struct elf_file));
+    int res = 0;
     int fd = 0;
-    int res = fopen(fname, "r");
-    if (res <= 0) {
-        res = -EIO;
-        goto out;
-    }
 
-    fd = res;
-    struct file_stat stat;
-    res = fstat(fd, &stat);
+    // already loaded for another instance, no disk access needed
+    struct elf_file* file = elf_cache_find(fname);
+    if (file) {
+        *file_out = elf_ref(file);
+        return 0;
+    }
 
-    if (res < 0) {
+    file = kzalloc(sizeof(struct elf_file));
+    if (!file) {
+        res = -ENOMEM;
         goto out;
     }
 
-    file->elf_mem = kzalloc(stat.size);
-    res = fread(file->elf_mem, stat.size, 1, fd);
-    
-    if (res < 0) {
+    res = fopen(fname, "r");
+    if (res <= 0) {
+        res = -EIO;
         goto out;
     }
 
-    res = elf_process_loaded(file);
+    fd = res;
+    strncpy(file->fname, fname, sizeof(file->fname));
+    file->refcount = 1;
+
+    res = elf_process_loaded(file, fd);
 
     if (res < 0) {
         goto out;
     }
 
+    elf_cache_insert(file);
     *file_out = file;
 
 out:
-    fclose(fd);
-    return 0;
+    if (res < 0 && file) {
+        elf_free(file);
+    }
+
+    if (fd) {
+        fclose(fd);
+    }
+    return res;
+}
+
+struct elf_file* elf_ref(struct elf_file* file) {
+    file->refcount++;
+    return file;
 }
 
 void elf_close(struct elf_file* file) {
@@ -190,6 +323,9 @@ void elf_close(struct elf_file* file) {
         return;
     }
 
-    kfree(file->elf_mem);
-    kfree(file);
+    if (--file->refcount > 0) {
+        return;
+    }
+
+    elf_free(file);
 }
\ No newline at end of file
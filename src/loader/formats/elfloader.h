@@ -7,13 +7,25 @@
 #include "elf.h"
 #include "../../config.h"
 
+// a PT_LOAD segment as it gets mapped
+struct elf_segment {
+    struct elf32_phdr phdr;
+
+    // the pages from p_vaddr's page up to the end of the file data, zero around the data (0 if it's all bss)
+    void* mem;
+    uint32_t total_pages;
+};
+
 struct elf_file {
     char fname[BENOS_MAX_PATH];
 
-    int in_mem_size;
+    struct elf_header header;
+
+    // program headers, copied out of the file
+    struct elf32_phdr* phdrs;
 
-    //phys mem address that this efl file is loaded at
-    void* elf_mem;
+    struct elf_segment* segments;
+    int total_segments;
 
     //virt base address of this binary
     void* virt_base_address;
@@ -21,26 +33,23 @@ struct elf_file {
     //virt end address of this binary
     void* virt_end_address;
 
-    //phys base address of this binary
-    void* phys_base_address;
+    // users of this file (processes and the image cache), freed by the last elf_close
+    int refcount;
 
-    //phys end address of this binary
-    void* phys_end_address;
+    // when the cache last handed this file out
+    uint32_t last_used;
 };
 
 int elf_load(const char* fname, struct elf_file** file_out);
 void elf_close(struct elf_file* file);
+struct elf_file* elf_ref(struct elf_file* file);
 void* elf_virtual_base(struct elf_file* file);
 void* elf_virtual_end(struct elf_file* file);
-void* elf_phys_base(struct elf_file* file);
-void* elf_phys_end(struct elf_file* file);
 
 struct elf_header* elf_header(struct elf_file* file);
-struct elf32_shdr* elf_sheader(struct elf_header* header);
-void* elf_memory(struct elf_file* file);
-struct elf32_phdr* elf_pheader(struct elf_header* header);
-struct elf32_phdr* elf_program_header(struct elf_header* header, int index);
-struct elf32_shdr* elf_section(struct elf_header* header, int index);
-void* elf_phdr_phys_address(struct elf_file* file, struct elf32_phdr* phdr);
+struct elf32_phdr* elf_pheader(struct elf_file* file);
+struct elf32_phdr* elf_program_header(struct elf_file* file, int index);
+int elf_total_segments(struct elf_file* file);
+struct elf_segment* elf_segment(struct elf_file* file, int index);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,77 @@
+#include "e820.h"
+#include "memory.h"
+#include <stdbool.h>
+
+// copy of the bios memory map, the low memory boot.asm left it in isn't reserved
+static struct e820_map e820_map;
+
+void e820_init() {
+    struct e820_map* boot_map = (struct e820_map*) BENOS_E820_MAP_ADDRESS;
+    memset(&e820_map, 0, sizeof(e820_map));
+
+    // no map (or garbage) means the bios doesn't support e820
+    if (boot_map->total == 0 || boot_map->total > BENOS_E820_MAX_ENTRIES) {
+        return;
+    }
+
+    memcpy(&e820_map, boot_map, sizeof(e820_map));
+}
+
+struct e820_map* e820_get_map() {
+    return &e820_map;
+}
+
+static bool e820_entry_contains(struct e820_entry* entry, uint64_t addr) {
+    return entry->length && addr >= entry->base && addr < entry->base + entry->length;
+}
+
+// end of the usable ram that starts at addr (capped at limit), 0 if addr isn't usable
+uint32_t e820_usable_end(uint32_t addr, uint32_t limit) {
+    uint64_t end = addr;
+
+    // usable entries can touch or overlap, keep extending until none continues the run
+    bool extended = true;
+    while (extended && end < limit) {
+        extended = false;
+        for (int i = 0; i < e820_map.total; i++) {
+            struct e820_entry* entry = &e820_map.entries[i];
+            if (entry->type == E820_TYPE_USABLE && e820_entry_contains(entry, end)) {
+                end = entry->base + entry->length;
+                extended = true;
+            }
+        }
+    }
+
+    if (end > limit) {
+        end = limit;
+    }
+
+    // anything else overlapping the run wins over usable
+    for (int i = 0; i < e820_map.total; i++) {
+        struct e820_entry* entry = &e820_map.entries[i];
+        if (entry->type == E820_TYPE_USABLE || !entry->length) {
+            continue;
+        }
+
+        if (e820_entry_contains(entry, addr)) {
+            return 0;
+        }
+
+        if (entry->base > addr && entry->base < end) {
+            end = entry->base;
+        }
+    }
+
+    return end > addr ? (uint32_t) end : 0;
+}
+
+// end of the ram the kernel heap and the page frames share
+uint32_t e820_kernel_ram_end() {
+    uint32_t end = e820_usable_end(BENOS_HEAD_ADDRESS, BENOS_KERNEL_MEMORY_LIMIT);
+    if (!end && e820_map.total == 0) {
+        // no memory map from the bios, assume the old fixed size
+        end = BENOS_HEAD_ADDRESS + BENOS_FALLBACK_RAM_BYTES;
+    }
+
+    return end;
+}
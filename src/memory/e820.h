@@ -0,0 +1,29 @@
+#ifndef E820_H
+#define E820_H
+
+#include "../config.h"
+#include <stdint.h>
+
+#define E820_TYPE_USABLE 1
+
+// one entry as the bios writes it (int 0x15, eax=0xE820)
+struct e820_entry {
+    uint64_t base;
+    uint64_t length;
+    uint32_t type;
+    uint32_t acpi;
+} __attribute__((packed));
+
+// layout of the map boot.asm leaves at BENOS_E820_MAP_ADDRESS
+struct e820_map {
+    uint32_t total;
+    uint32_t reserved;
+    struct e820_entry entries[BENOS_E820_MAX_ENTRIES];
+} __attribute__((packed));
+
+void e820_init();
+struct e820_map* e820_get_map();
+uint32_t e820_usable_end(uint32_t addr, uint32_t limit);
+uint32_t e820_kernel_ram_end();
+
+#endif
@@ -0,0 +1,293 @@
+#include "frame.h"
+#include "e820.h"
+#include "memory.h"
+#include "heap/kheap.h"
+#include "../config.h"
+#include "../kernel.h"
+#include "../status.h"
+
+static struct frame_allocator frames;
+
+static bool frame_is_free(uint32_t index) {
+    return frames.bitmap[index / 32] & (1u << (index % 32));
+}
+
+static void* frame_index_to_address(uint32_t index) {
+    return (void*)(frames.start + index * FRAME_SIZE);
+}
+
+static uint32_t frame_address_to_index(void* frame) {
+    return ((uint32_t)frame - frames.start) / FRAME_SIZE;
+}
+
+static void frame_list_push(uint32_t index) {
+    struct frame_free_node* node = frame_index_to_address(index);
+    node->prev = 0;
+    node->next = frames.free_list;
+    if (node->next) {
+        node->next->prev = node;
+    }
+    frames.free_list = node;
+}
+
+static void frame_list_remove(uint32_t index) {
+    struct frame_free_node* node = frame_index_to_address(index);
+    if (node->prev) {
+        node->prev->next = node->next;
+    } else {
+        frames.free_list = node->next;
+    }
+
+    if (node->next) {
+        node->next->prev = node->prev;
+    }
+}
+
+static void frame_mark_taken(uint32_t index) {
+    frame_list_remove(index);
+    frames.bitmap[index / 32] &= ~(1u << (index % 32));
+    frames.refcounts[index] = 1;
+    frames.total_free--;
+}
+
+static void frame_mark_free(uint32_t index) {
+    frames.bitmap[index / 32] |= (1u << (index % 32));
+    frames.refcounts[index] = 0;
+    frame_list_push(index);
+    frames.total_free++;
+}
+
+void frame_init() {
+    uint32_t start = (uint32_t) kheap_end();
+    uint32_t end = e820_kernel_ram_end();
+    start += (FRAME_SIZE - (start % FRAME_SIZE)) % FRAME_SIZE;
+    end -= end % FRAME_SIZE;
+
+    memset(&frames, 0, sizeof(frames));
+    if (end <= start) {
+        print("\nNo memory left for page frames");
+        return;
+    }
+
+    // the bitmap and the reference counts take the first frames of the range, one entry per frame that follows them
+    uint32_t total_frames = (end - start) / FRAME_SIZE;
+    uint32_t bitmap_words = (total_frames + 31) / 32;
+    uint32_t refcounts_size = total_frames * sizeof(uint16_t);
+    uint32_t meta_frames = frame_size_to_frames(bitmap_words * sizeof(uint32_t) + refcounts_size);
+
+    frames.bitmap = (uint32_t*) start;
+    frames.refcounts = (uint16_t*) (start + bitmap_words * sizeof(uint32_t));
+    frames.start = start + meta_frames * FRAME_SIZE;
+    frames.total = total_frames - meta_frames;
+    memset(frames.bitmap, 0, bitmap_words * sizeof(uint32_t) + refcounts_size);
+
+    // pushed from the top so the lowest frames get handed out first
+    for (int i = frames.total - 1; i >= 0; i--) {
+        frame_mark_free(i);
+    }
+}
+
+uint32_t frame_size_to_frames(size_t size) {
+    return (size + FRAME_SIZE - 1) / FRAME_SIZE;
+}
+
+uint32_t frame_total_free() {
+    return frames.total_free + frames.total_zeroed;
+}
+
+static void* frame_zero_pool_take() {
+    struct frame_free_node* node = frames.zeroed_list;
+    if (!node) {
+        return 0;
+    }
+
+    frames.zeroed_list = node->next;
+    frames.total_zeroed--;
+
+    // the links were the only thing written to it
+    node->next = 0;
+    return node;
+}
+
+void* frame_alloc() {
+    if (!frames.free_list) {
+        // zeroed frames are still free frames
+        return frame_zero_pool_take();
+    }
+
+    void* frame = frames.free_list;
+    frame_mark_taken(frame_address_to_index(frame));
+    return frame;
+}
+
+// zeroes up to max_frames free frames into the zero pool, called when nothing else has to run, returns how many
+uint32_t frame_zero_pool_refill(uint32_t max_frames) {
+    uint32_t i = 0;
+    for (; i < max_frames && frames.total_zeroed < BENOS_ZERO_FRAME_POOL_SIZE; i++) {
+        if (!frames.free_list) {
+            break;
+        }
+
+        struct frame_free_node* node = frame_alloc();
+
+        memset(node, 0x00, FRAME_SIZE);
+        node->prev = 0;
+        node->next = frames.zeroed_list;
+        frames.zeroed_list = node;
+        frames.total_zeroed++;
+    }
+
+    return i;
+}
+
+// hands the zero pool back so its frames can be part of a contiguous run again
+static void frame_zero_pool_drain() {
+    void* frame = 0;
+    while ((frame = frame_zero_pool_take())) {
+        frame_free(frame);
+    }
+}
+
+void* frame_zalloc() {
+    void* frame = frame_zero_pool_take();
+    if (frame) {
+        return frame;
+    }
+
+    frame = frame_alloc();
+    if (frame) {
+        memset(frame, 0x00, FRAME_SIZE);
+    }
+    return frame;
+}
+
+// first run of total_frames free frames in the bitmap that starts on an align_frames boundary, fully taken words are skipped
+static int frame_find_contiguous(uint32_t total_frames, uint32_t align_frames) {
+    uint32_t run = 0;
+    uint32_t first_frame = frames.start / FRAME_SIZE;
+    for (uint32_t i = 0; i < frames.total; i++) {
+        if ((i % 32) == 0 && frames.bitmap[i / 32] == 0) {
+            run = 0;
+            i += 31;
+            continue;
+        }
+
+        if (!frame_is_free(i) || (run == 0 && ((first_frame + i) % align_frames) != 0)) {
+            run = 0;
+            continue;
+        }
+
+        run++;
+        if (run == total_frames) {
+            return i - total_frames + 1;
+        }
+    }
+
+    return -ENOMEM;
+}
+
+// align is in bytes and a power of two multiple of the frame size (physical address of the first frame)
+void* frame_alloc_contiguous_aligned(uint32_t total_frames, uint32_t align) {
+    if (total_frames == 0) {
+        total_frames = 1;
+    }
+
+    uint32_t align_frames = align > FRAME_SIZE ? align / FRAME_SIZE : 1;
+    if (total_frames == 1 && align_frames == 1) {
+        return frame_alloc();
+    }
+
+    int first = frame_find_contiguous(total_frames, align_frames);
+    if (first < 0 && frames.total_zeroed) {
+        frame_zero_pool_drain();
+        first = frame_find_contiguous(total_frames, align_frames);
+    }
+
+    if (first < 0) {
+        return 0;
+    }
+
+    for (uint32_t i = 0; i < total_frames; i++) {
+        frame_mark_taken(first + i);
+    }
+
+    return frame_index_to_address(first);
+}
+
+void* frame_alloc_contiguous(uint32_t total_frames) {
+    return frame_alloc_contiguous_aligned(total_frames, FRAME_SIZE);
+}
+
+void* frame_zalloc_contiguous_aligned(uint32_t total_frames, uint32_t align) {
+    if (total_frames <= 1 && align <= FRAME_SIZE) {
+        return frame_zalloc();
+    }
+
+    void* frame = frame_alloc_contiguous_aligned(total_frames, align);
+    if (frame) {
+        memset(frame, 0x00, (total_frames ? total_frames : 1) * FRAME_SIZE);
+    }
+    return frame;
+}
+
+void* frame_zalloc_contiguous(uint32_t total_frames) {
+    return frame_zalloc_contiguous_aligned(total_frames, FRAME_SIZE);
+}
+
+// index of a taken frame of ours, -EINVARG for anything else
+static int frame_taken_index(void* frame) {
+    if ((uint32_t)frame < frames.start || ((uint32_t)frame % FRAME_SIZE)) {
+        return -EINVARG;
+    }
+
+    uint32_t index = frame_address_to_index(frame);
+    if (index >= frames.total || frame_is_free(index)) {
+        return -EINVARG;
+    }
+
+    return index;
+}
+
+// drops one reference, the frame is only free once the last user gave it back
+void frame_free(void* frame) {
+    int index = frame_taken_index(frame);
+    if (index < 0) {
+        // not ours or freed twice
+        return;
+    }
+
+    if (frames.refcounts[index] > 1) {
+        frames.refcounts[index]--;
+        return;
+    }
+
+    frame_mark_free(index);
+}
+
+void frame_ref(void* frame) {
+    int index = frame_taken_index(frame);
+    if (index >= 0) {
+        frames.refcounts[index]++;
+    }
+}
+
+void frame_ref_contiguous(void* frame, uint32_t total_frames) {
+    for (uint32_t i = 0; i < total_frames; i++) {
+        frame_ref(frame + i * FRAME_SIZE);
+    }
+}
+
+uint32_t frame_refcount(void* frame) {
+    int index = frame_taken_index(frame);
+    if (index < 0) {
+        return 0;
+    }
+
+    return frames.refcounts[index];
+}
+
+void frame_free_contiguous(void* frame, uint32_t total_frames) {
+    for (uint32_t i = 0; i < total_frames; i++) {
+        frame_free(frame + i * FRAME_SIZE);
+    }
+}
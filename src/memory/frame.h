@@ -0,0 +1,52 @@
+#ifndef FRAME_H
+#define FRAME_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#define FRAME_SIZE 4096
+
+// lives in the first bytes of every free frame
+struct frame_free_node {
+    struct frame_free_node* next;
+    struct frame_free_node* prev;
+};
+
+struct frame_allocator {
+    // physical address of the first managed frame
+    uint32_t start;
+    uint32_t total;
+    uint32_t total_free;
+
+    // one bit per frame, set when the frame is free
+    uint32_t* bitmap;
+
+    // users of every taken frame (page mappings shared after a fork), the frame is free again when it drops to 0
+    uint16_t* refcounts;
+
+    // free frames for single frame allocations
+    struct frame_free_node* free_list;
+
+    // frames zeroed ahead of time, taken out of the bitmap while they sit here
+    struct frame_free_node* zeroed_list;
+    uint32_t total_zeroed;
+};
+
+void frame_init();
+void* frame_alloc();
+void* frame_zalloc();
+void* frame_alloc_contiguous(uint32_t total_frames);
+void* frame_zalloc_contiguous(uint32_t total_frames);
+void* frame_alloc_contiguous_aligned(uint32_t total_frames, uint32_t align);
+void* frame_zalloc_contiguous_aligned(uint32_t total_frames, uint32_t align);
+void frame_free(void* frame);
+void frame_free_contiguous(void* frame, uint32_t total_frames);
+void frame_ref(void* frame);
+void frame_ref_contiguous(void* frame, uint32_t total_frames);
+uint32_t frame_refcount(void* frame);
+uint32_t frame_zero_pool_refill(uint32_t max_frames);
+uint32_t frame_size_to_frames(size_t size);
+uint32_t frame_total_free();
+
+#endif
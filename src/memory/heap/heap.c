@@ -4,6 +4,8 @@
 #include "memory/memory.h"
 #include <stdbool.h>
 
+static void heap_free_run_insert(struct heap* heap, int start_block, uint32_t total_blocks);
+
 static int heap_validate_table(void* ptr, void* end, struct heap_table* table) {
     int res = 0;
 
@@ -32,6 +34,9 @@ int heap_create(struct heap* heap, void* ptr, void* end, struct heap_table* tabl
     memset(heap, 0, sizeof(struct heap));
     heap->saddr = ptr;
     heap->table = table;
+#if BENOS_HEAP_STATS
+    heap->stats.total_blocks = table->total;
+#endif
 
     res = heap_validate_table(ptr, end, table);
     if (res < 0) {
@@ -42,6 +47,11 @@ int heap_create(struct heap* heap, void* ptr, void* end, struct heap_table* tabl
     // initialize the heap table
     memset(table->entries, HEAP_BLOCK_TABLE_ENTRY_FREE, table_size);
 
+    // the whole pool starts out as one free run
+    if (table->total > 0) {
+        heap_free_run_insert(heap, 0, table->total);
+    }
+
 out:
     return res;
 }
@@ -60,60 +70,150 @@ static uint32_t heap_align_value_to_upper(uint32_t val) {
 static int heap_get_entry_type(HEAP_BLOCK_TABLE_ENTRY entry) {
     return entry & 0x0f;
 }
-int heap_get_start_block(struct heap* heap, uint32_t total_blocks) {
-    struct heap_table* table = heap->table;
-    int bc = 0; // current block count
-    int bs = -1; // block start
-
-    for (size_t i = 0; i < table->total; i++) {
-        if (heap_get_entry_type(table->entries[i]) != HEAP_BLOCK_TABLE_ENTRY_FREE) {
-            bc = 0;
-            bs = -1;
-            continue;
-        }
 
-        //this is the first block
-        if (bs == -1) {
-            bs = i;
-        }
+static uint32_t heap_get_entry_run_blocks(HEAP_BLOCK_TABLE_ENTRY entry) {
+    return entry >> HEAP_BLOCK_RUN_SHIFT;
+}
 
-        bc++;
+static bool heap_block_is_free(struct heap* heap, int block) {
+    return heap_get_entry_type(heap->table->entries[block]) == HEAP_BLOCK_TABLE_ENTRY_FREE;
+}
 
-        if (bc == total_blocks) {
-            // found a start block that has enough blocks
-            break;
-        }
+void* heap_block_to_address(struct heap* heap, int block) {
+    return heap->saddr + (block * BENOS_HEAP_BLOCK_SIZE);
+}
+
+int heap_address_to_block(struct heap* heap, void* addr) {
+    return ((int)(addr - heap->saddr)) / BENOS_HEAP_BLOCK_SIZE;
+}
+
+// a run is recorded on its first and last entry only, the entries in between are never read
+static void heap_mark_run(struct heap* heap, int start_block, uint32_t total_blocks, int type) {
+    HEAP_BLOCK_TABLE_ENTRY entry = (total_blocks << HEAP_BLOCK_RUN_SHIFT) | type;
+    int end_block = start_block + total_blocks - 1;
+
+    heap->table->entries[end_block] = entry | HEAP_BLOCK_IS_LAST;
+    if (start_block == end_block) {
+        entry |= HEAP_BLOCK_IS_LAST;
     }
+    heap->table->entries[start_block] = entry | HEAP_BLOCK_IS_FIRST;
+}
 
-    // out of memory
-    if (bs == -1) {
-        return -ENOMEM;
+// bin of a run: floor(log2(total_blocks))
+static int heap_free_run_bin(uint32_t total_blocks) {
+    int bin = 0;
+    while (total_blocks >>= 1) {
+        bin++;
     }
 
-    return bs;
+    return bin;
+}
+
+static void heap_free_run_insert(struct heap* heap, int start_block, uint32_t total_blocks) {
+    struct heap_free_run* run = heap_block_to_address(heap, start_block);
+    int bin = heap_free_run_bin(total_blocks);
 
+    heap_mark_run(heap, start_block, total_blocks, HEAP_BLOCK_TABLE_ENTRY_FREE);
 
+    run->prev = 0;
+    run->next = heap->free_runs[bin];
+    if (run->next) {
+        run->next->prev = run;
+    }
+    heap->free_runs[bin] = run;
 }
 
-void* heap_block_to_address(struct heap* heap, int block) {
-    return heap->saddr + (block * BENOS_HEAP_BLOCK_SIZE);
+static void heap_free_run_remove(struct heap* heap, int start_block) {
+    struct heap_free_run* run = heap_block_to_address(heap, start_block);
+    if (run->prev) {
+        run->prev->next = run->next;
+    } else {
+        uint32_t total_blocks = heap_get_entry_run_blocks(heap->table->entries[start_block]);
+        heap->free_runs[heap_free_run_bin(total_blocks)] = run->next;
+    }
+
+    if (run->next) {
+        run->next->prev = run->prev;
+    }
 }
 
-void heap_mark_blocks_taken(struct heap* heap, int start_block, int total_blocks) {
-    int end_block = (start_block + total_blocks) - 1;
+static int heap_find_free_run(struct heap* heap, uint32_t total_blocks) {
+    int bin = heap_free_run_bin(total_blocks);
 
-    HEAP_BLOCK_TABLE_ENTRY entry = HEAP_BLOCK_TABLE_ENTRY_TAKEN | HEAP_BLOCK_IS_FIRST;
-    if (total_blocks > 1) {
-        entry |= HEAP_BLOCK_HAS_NEXT;
+    // runs in the request's own bin are the closest fit, but some may be too short
+    for (struct heap_free_run* run = heap->free_runs[bin]; run; run = run->next) {
+        int block = heap_address_to_block(heap, run);
+        if (heap_get_entry_run_blocks(heap->table->entries[block]) >= total_blocks) {
+            return block;
+        }
     }
 
-    for (int i = start_block; i <= end_block; i++) {
-        heap->table->entries[i] = entry;
-        entry = HEAP_BLOCK_TABLE_ENTRY_TAKEN;
-        if (i != end_block-1) {
-            entry |= HEAP_BLOCK_HAS_NEXT;
+    // any run in a higher bin is big enough, so take the first one
+    for (int i = bin + 1; i < HEAP_FREE_RUN_BINS; i++) {
+        if (heap->free_runs[i]) {
+            return heap_address_to_block(heap, heap->free_runs[i]);
         }
     }
+
+    return -ENOMEM;
+}
+
+// takes total_blocks from the front of the free run at start_block, the rest stays free
+static void heap_take_from_free_run(struct heap* heap, int start_block, uint32_t total_blocks) {
+    uint32_t run_blocks = heap_get_entry_run_blocks(heap->table->entries[start_block]);
+    heap_free_run_remove(heap, start_block);
+
+    if (run_blocks > total_blocks) {
+        heap_free_run_insert(heap, start_block + total_blocks, run_blocks - total_blocks);
+    }
+}
+
+int heap_get_start_block(struct heap* heap, uint32_t total_blocks) {
+    int start_block = heap_find_free_run(heap, total_blocks);
+
+    // out of memory
+    if (start_block < 0) {
+        return -ENOMEM;
+    }
+
+    heap_take_from_free_run(heap, start_block, total_blocks);
+    return start_block;
+}
+
+// live block accounting, compiles to nothing without BENOS_HEAP_STATS
+static void heap_stats_blocks_changed(struct heap* heap, int delta) {
+#if BENOS_HEAP_STATS
+    heap->stats.live_blocks += delta;
+    if (heap->stats.live_blocks > heap->stats.peak_live_blocks) {
+        heap->stats.peak_live_blocks = heap->stats.live_blocks;
+    }
+#endif
+}
+
+static void heap_stats_allocated(struct heap* heap, uint32_t total_blocks) {
+#if BENOS_HEAP_STATS
+    heap->stats.total_allocations++;
+    heap->stats.live_allocations++;
+#endif
+    heap_stats_blocks_changed(heap, total_blocks);
+}
+
+static void heap_stats_freed(struct heap* heap, uint32_t total_blocks) {
+#if BENOS_HEAP_STATS
+    heap->stats.total_frees++;
+    heap->stats.live_allocations--;
+#endif
+    heap_stats_blocks_changed(heap, -(int)total_blocks);
+}
+
+static void heap_stats_failed(struct heap* heap) {
+#if BENOS_HEAP_STATS
+    heap->stats.failed_allocations++;
+#endif
+}
+
+void heap_mark_blocks_taken(struct heap* heap, int start_block, int total_blocks) {
+    heap_mark_run(heap, start_block, total_blocks, HEAP_BLOCK_TABLE_ENTRY_TAKEN);
 }
 
 void * heap_malloc_blocks(struct heap* heap, uint32_t total_blocks) {
@@ -121,6 +221,7 @@ void * heap_malloc_blocks(struct heap* heap, uint32_t total_blocks) {
 
     int start_block = heap_get_start_block(heap, total_blocks);
     if(start_block < 0) {
+        heap_stats_failed(heap);
         goto out;
     }
 
@@ -128,34 +229,173 @@ void * heap_malloc_blocks(struct heap* heap, uint32_t total_blocks) {
 
     // mark the blocks as taken
     heap_mark_blocks_taken(heap, start_block, total_blocks);
+    heap_stats_allocated(heap, total_blocks);
 
 out:
     return address;
 }
 
-void heap_mark_blocks_free(struct heap* heap, int starting_block) {
-    struct heap_table* table = heap->table;
-    for (int i = starting_block; i < (int)table->total; i++) {
+// gives a run back to the free lists, merged with the free runs around it
+static void heap_release_run(struct heap* heap, int start_block, uint32_t total_blocks) {
+    // clear the old boundaries so they can't be mistaken for a live allocation later
+    heap_mark_run(heap, start_block, total_blocks, HEAP_BLOCK_TABLE_ENTRY_FREE);
 
-        HEAP_BLOCK_TABLE_ENTRY entry = table->entries[i];
-        table->entries[i] = HEAP_BLOCK_TABLE_ENTRY_FREE;
-        if (!(entry & HEAP_BLOCK_HAS_NEXT)) {
-            break;
-        }
+    // the entry after the run is the first entry of the next run
+    int next_block = start_block + total_blocks;
+    if (next_block < (int)heap->table->total && heap_block_is_free(heap, next_block)) {
+        total_blocks += heap_get_entry_run_blocks(heap->table->entries[next_block]);
+        heap_free_run_remove(heap, next_block);
     }
+
+    // the entry before the run is the last entry of the previous run
+    if (start_block > 0 && heap_block_is_free(heap, start_block - 1)) {
+        uint32_t prev_blocks = heap_get_entry_run_blocks(heap->table->entries[start_block - 1]);
+        start_block -= prev_blocks;
+        total_blocks += prev_blocks;
+        heap_free_run_remove(heap, start_block);
+    }
+
+    heap_free_run_insert(heap, start_block, total_blocks);
 }
 
-int heap_address_to_block(struct heap* heap, void* addr) {
-    return ((int)(addr - heap->saddr)) / BENOS_HEAP_BLOCK_SIZE;
+void heap_mark_blocks_free(struct heap* heap, int starting_block) {
+    uint32_t total_blocks = heap_get_entry_run_blocks(heap->table->entries[starting_block]);
+    heap_release_run(heap, starting_block, total_blocks);
+    heap_stats_freed(heap, total_blocks);
+}
+
+static uint32_t heap_size_to_blocks(size_t size) {
+    uint32_t total_blocks = heap_align_value_to_upper(size) / BENOS_HEAP_BLOCK_SIZE;
+    if (total_blocks == 0) {
+        total_blocks = 1;
+    }
+
+    return total_blocks;
 }
 
 void* heap_malloc(struct heap* heap, size_t size) {
-    size_t alligned_size = heap_align_value_to_upper(size);
-    uint32_t total_blocks = alligned_size / BENOS_HEAP_BLOCK_SIZE;
+    return heap_malloc_blocks(heap, heap_size_to_blocks(size));
+}
 
-    return heap_malloc_blocks(heap, total_blocks);
+// returns the first block of the allocation ptr points to or -EINVARG if it's not one
+static int heap_get_allocation_block(struct heap* heap, void* ptr) {
+    if (ptr < heap->saddr || !heap_validate_alignment(ptr)) {
+        return -EINVARG;
+    }
+
+    int block = heap_address_to_block(heap, ptr);
+    if (block >= (int)heap->table->total) {
+        return -EINVARG;
+    }
+
+    HEAP_BLOCK_TABLE_ENTRY entry = heap->table->entries[block];
+    if (heap_get_entry_type(entry) != HEAP_BLOCK_TABLE_ENTRY_TAKEN || !(entry & HEAP_BLOCK_IS_FIRST)) {
+        return -EINVARG;
+    }
+
+    return block;
 }
 
 void heap_free(struct heap* heap, void* ptr) {
-    heap_mark_blocks_free(heap, heap_address_to_block(heap, ptr));
-}
\ No newline at end of file
+    int start_block = heap_get_allocation_block(heap, ptr);
+    if (start_block < 0) {
+        // not the start of an allocation
+        return;
+    }
+
+    heap_mark_blocks_free(heap, start_block);
+}
+
+size_t heap_allocation_size(struct heap* heap, void* ptr) {
+    int start_block = heap_get_allocation_block(heap, ptr);
+    if (start_block < 0) {
+        return 0;
+    }
+
+    return heap_get_entry_run_blocks(heap->table->entries[start_block]) * BENOS_HEAP_BLOCK_SIZE;
+}
+
+void* heap_realloc(struct heap* heap, void* ptr, size_t size) {
+    int start_block = heap_get_allocation_block(heap, ptr);
+    if (start_block < 0) {
+        return 0;
+    }
+
+    uint32_t old_blocks = heap_get_entry_run_blocks(heap->table->entries[start_block]);
+    uint32_t new_blocks = heap_size_to_blocks(size);
+
+    // shrinking, give the tail back
+    if (new_blocks <= old_blocks) {
+        if (new_blocks < old_blocks) {
+            heap_mark_blocks_taken(heap, start_block, new_blocks);
+            heap_release_run(heap, start_block + new_blocks, old_blocks - new_blocks);
+            heap_stats_blocks_changed(heap, -(int)(old_blocks - new_blocks));
+        }
+        return ptr;
+    }
+
+    // growing into the free run right behind the allocation
+    int next_block = start_block + old_blocks;
+    if (next_block < (int)heap->table->total && heap_block_is_free(heap, next_block)
+        && old_blocks + heap_get_entry_run_blocks(heap->table->entries[next_block]) >= new_blocks) {
+        heap_take_from_free_run(heap, next_block, new_blocks - old_blocks);
+        heap_mark_blocks_taken(heap, start_block, new_blocks);
+        heap_stats_blocks_changed(heap, new_blocks - old_blocks);
+        return ptr;
+    }
+
+    // no room behind it, move it
+    void* new_ptr = heap_malloc_blocks(heap, new_blocks);
+    if (!new_ptr) {
+        return 0;
+    }
+
+    memcpy(new_ptr, ptr, old_blocks * BENOS_HEAP_BLOCK_SIZE);
+    heap_mark_blocks_free(heap, start_block);
+    return new_ptr;
+}
+
+void heap_stats_record_caller(struct heap* heap, void* caller, size_t size) {
+#if BENOS_HEAP_STATS
+    struct heap_stats* stats = &heap->stats;
+    for (int i = 0; i < stats->total_callers; i++) {
+        if (stats->callers[i].caller == caller) {
+            stats->callers[i].allocations++;
+            stats->callers[i].bytes += size;
+            return;
+        }
+    }
+
+    if (stats->total_callers >= BENOS_HEAP_STATS_MAX_CALLERS) {
+        stats->untracked_allocations++;
+        return;
+    }
+
+    struct heap_caller_stats* entry = &stats->callers[stats->total_callers++];
+    entry->caller = caller;
+    entry->allocations = 1;
+    entry->bytes = size;
+#endif
+}
+
+int heap_get_stats(struct heap* heap, struct heap_stats* stats) {
+#if BENOS_HEAP_STATS
+    memcpy(stats, &heap->stats, sizeof(struct heap_stats));
+    stats->free_runs = 0;
+    stats->largest_free_run = 0;
+    for (int i = 0; i < HEAP_FREE_RUN_BINS; i++) {
+        for (struct heap_free_run* run = heap->free_runs[i]; run; run = run->next) {
+            int block = heap_address_to_block(heap, run);
+            uint32_t run_blocks = heap_get_entry_run_blocks(heap->table->entries[block]);
+            if (run_blocks > stats->largest_free_run) {
+                stats->largest_free_run = run_blocks;
+            }
+            stats->free_runs++;
+        }
+    }
+
+    return 0;
+#else
+    return -EUNIMP;
+#endif
+}
@@ -8,15 +8,54 @@
 #define HEAP_BLOCK_TABLE_ENTRY_TAKEN 0x01
 #define HEAP_BLOCK_TABLE_ENTRY_FREE 0x00
 
-#define HEAP_BLOCK_HAS_NEXT 0b10000000
+#define HEAP_BLOCK_IS_LAST   0b10000000
 #define HEAP_BLOCK_IS_FIRST  0b01000000
 
-typedef unsigned char HEAP_BLOCK_TABLE_ENTRY;
+// the first and last entry of every run (taken or free) also hold the run's length in blocks
+#define HEAP_BLOCK_RUN_SHIFT 8
+
+// bin n holds the free runs that are [2^n, 2^(n+1)) blocks long
+#define HEAP_FREE_RUN_BINS 32
+
+typedef uint32_t HEAP_BLOCK_TABLE_ENTRY;
 
 struct heap_table {
     HEAP_BLOCK_TABLE_ENTRY* entries;
     size_t total;
-    
+
+};
+
+// lives in the first block of every free run
+struct heap_free_run {
+    struct heap_free_run* next;
+    struct heap_free_run* prev;
+};
+
+struct heap_caller_stats {
+    // return address of the allocating call
+    void* caller;
+    uint32_t allocations;
+    uint32_t bytes;
+};
+
+struct heap_stats {
+    uint32_t total_blocks;
+    uint32_t live_blocks;
+    uint32_t peak_live_blocks;
+    uint32_t live_allocations;
+
+    // filled in by heap_get_stats from the free run bins
+    uint32_t free_runs;
+    uint32_t largest_free_run;
+
+    uint32_t total_allocations;
+    uint32_t total_frees;
+    uint32_t failed_allocations;
+
+    // allocations whose caller didn't fit in the callers table
+    uint32_t untracked_allocations;
+    uint32_t total_callers;
+    struct heap_caller_stats callers[BENOS_HEAP_STATS_MAX_CALLERS];
 };
 
 struct heap {
@@ -24,10 +63,21 @@ struct heap {
 
     // start address of the heap data pool
     void* saddr;
+
+    // segregated lists of free runs, indexed by the size of the run
+    struct heap_free_run* free_runs[HEAP_FREE_RUN_BINS];
+
+#if BENOS_HEAP_STATS
+    struct heap_stats stats;
+#endif
 };
 
 int heap_create(struct heap* heap, void* ptr, void* end, struct heap_table* table);
 void* heap_malloc(struct heap* heap, size_t size);
 void heap_free(struct heap* heap, void* ptr);
+void* heap_realloc(struct heap* heap, void* ptr, size_t size);
+size_t heap_allocation_size(struct heap* heap, void* ptr);
+void heap_stats_record_caller(struct heap* heap, void* caller, size_t size);
+int heap_get_stats(struct heap* heap, struct heap_stats* stats);
 
-#endif
\ No newline at end of file
+#endif
@@ -1,35 +1,100 @@
 #include "kheap.h"
 #include "heap.h"
+#include "slab.h"
 #include "../../config.h"
 #include "../../kernel.h"
 #include "../memory.h"
+#include "../e820.h"
 
 struct heap kernel_heap;
 struct heap_table kernel_heap_table;
 
+// small allocations are served from these size classes instead of whole heap blocks
+static struct kmem_cache kmalloc_caches[] = {
+    {.name = "kmalloc-16", .size = 16},
+    {.name = "kmalloc-32", .size = 32},
+    {.name = "kmalloc-64", .size = 64},
+    {.name = "kmalloc-128", .size = 128},
+    {.name = "kmalloc-256", .size = 256},
+    {.name = "kmalloc-512", .size = 512},
+    {.name = "kmalloc-1024", .size = 1024},
+};
+
+#define KHEAP_TOTAL_SIZE_CLASSES (sizeof(kmalloc_caches) / sizeof(struct kmem_cache))
+
 void kheap_init() {
+    uint32_t start = BENOS_HEAD_ADDRESS;
+    uint32_t end = e820_kernel_ram_end();
+    if (end > start) {
+        // the rest of the ram is left for the page frame allocator
+        uint32_t heap_size = (end - start) / BENOS_HEAP_RAM_DIVISOR;
+        if (heap_size > BENOS_HEAP_MAX_BYTES) {
+            heap_size = BENOS_HEAP_MAX_BYTES;
+        }
+        end = start + heap_size;
+    }
+    end -= end % BENOS_HEAP_BLOCK_SIZE;
 
-    // create the heap table
-    int total_table_entries = BENOS_HEAP_SIZE_BYTES / BENOS_HEAP_BLOCK_SIZE;
-    kernel_heap_table.entries = (HEAP_BLOCK_TABLE_ENTRY*) BENOS_HEAP_TABLE_ADDRESS ;
+    // every block costs its size plus its table entry
+    uint32_t total_table_entries = 0;
+    uint32_t table_size = 0;
+    if (end > start) {
+        total_table_entries = (end - start) / (BENOS_HEAP_BLOCK_SIZE + sizeof(HEAP_BLOCK_TABLE_ENTRY));
+        table_size = total_table_entries * sizeof(HEAP_BLOCK_TABLE_ENTRY);
+        table_size += (BENOS_HEAP_BLOCK_SIZE - (table_size % BENOS_HEAP_BLOCK_SIZE)) % BENOS_HEAP_BLOCK_SIZE;
+        if (start + table_size + total_table_entries * BENOS_HEAP_BLOCK_SIZE > end) {
+            total_table_entries--;
+        }
+    }
+
+    // create the heap table in front of the blocks it describes
+    kernel_heap_table.entries = (HEAP_BLOCK_TABLE_ENTRY*) start;
     kernel_heap_table.total = total_table_entries;
 
-    void* end = (void*) BENOS_HEAD_ADDRESS + BENOS_HEAP_SIZE_BYTES;
+    void* heap_start = (void*) start + table_size;
+    void* heap_end = heap_start + total_table_entries * BENOS_HEAP_BLOCK_SIZE;
 
     // create the heap
-    int res = heap_create(&kernel_heap, (void*) BENOS_HEAD_ADDRESS, end, &kernel_heap_table);
+    int res = heap_create(&kernel_heap, heap_start, heap_end, &kernel_heap_table);
 
-    if (res < 0) {
+    if (res < 0 || total_table_entries == 0) {
         print("\nFailed to create kernel heap");
     }
 }
 
-void* kmalloc(size_t size) {
+// first address after the kernel heap
+void* kheap_end() {
+    return kernel_heap.saddr + kernel_heap_table.total * BENOS_HEAP_BLOCK_SIZE;
+}
+
+static struct kmem_cache* kheap_get_size_class(size_t size) {
+    for (int i = 0; i < KHEAP_TOTAL_SIZE_CLASSES; i++) {
+        if (size <= kmalloc_caches[i].size) {
+            return &kmalloc_caches[i];
+        }
+    }
+
+    return 0;
+}
+
+// caller is the return address of the public entry point, so the statistics point at the real call site
+static void* kheap_malloc(size_t size, void* caller) {
+    heap_stats_record_caller(&kernel_heap, caller, size);
+
+    struct kmem_cache* cache = kheap_get_size_class(size);
+    if (cache) {
+        return kmem_cache_alloc(cache);
+    }
+
     return heap_malloc(&kernel_heap, size);
 }
 
+void* kmalloc(size_t size) {
+    return kheap_malloc(size, __builtin_return_address(0));
+}
+
 void* kzalloc(size_t size) {
-    void* ptr = kmalloc(size);
+    void* ptr = kheap_malloc(size, __builtin_return_address(0));
     if (!ptr) {
         return 0;
     }
@@ -37,6 +102,66 @@ void* kzalloc(size_t size) {
     return ptr;
 }
 
+// grows in place when the blocks behind the allocation are free, copies only when it has to
+void* krealloc(void* ptr, size_t size) {
+    if (!ptr) {
+        return kheap_malloc(size, __builtin_return_address(0));
+    }
+
+    if (size == 0) {
+        kfree(ptr);
+        return 0;
+    }
+
+    if (!kmem_is_slab_object(ptr)) {
+        return heap_realloc(&kernel_heap, ptr, size);
+    }
+
+    size_t old_size = kmem_object_size(ptr);
+    if (size <= old_size) {
+        return ptr;
+    }
+
+    void* new_ptr = kheap_malloc(size, __builtin_return_address(0));
+    if (!new_ptr) {
+        return 0;
+    }
+
+    memcpy(new_ptr, ptr, old_size);
+    kmem_free(ptr);
+    return new_ptr;
+}
+
+static void* kheap_malloc_pages(size_t size, void* caller) {
+    heap_stats_record_caller(&kernel_heap, caller, size);
+    return heap_malloc(&kernel_heap, size);
+}
+
+void* kmalloc_pages(size_t size) {
+    return kheap_malloc_pages(size, __builtin_return_address(0));
+}
+
+void* kzalloc_pages(size_t size) {
+    void* ptr = kheap_malloc_pages(size, __builtin_return_address(0));
+    if (!ptr) {
+        return 0;
+    }
+
+    // zero the whole blocks, they may end up mapped into a task
+    size_t total_blocks = (size + BENOS_HEAP_BLOCK_SIZE - 1) / BENOS_HEAP_BLOCK_SIZE;
+    memset(ptr, 0x00, total_blocks * BENOS_HEAP_BLOCK_SIZE);
+    return ptr;
+}
+
 void kfree(void* ptr) {
+    if (kmem_is_slab_object(ptr)) {
+        kmem_free(ptr);
+        return;
+    }
+
     heap_free(&kernel_heap, ptr);
-}
\ No newline at end of file
+}
+
+int kheap_get_stats(struct heap_stats* stats) {
+    return heap_get_stats(&kernel_heap, stats);
+}
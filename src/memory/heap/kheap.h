@@ -3,9 +3,20 @@
 
 #include <stdint.h>
 #include <stddef.h>
+
+struct heap_stats;
+
 void* kmalloc(size_t size);
 void kheap_init();
+void* kheap_end();
 void kfree(void* ptr);
 void* kzalloc(size_t size);
+void* krealloc(void* ptr, size_t size);
+
+// always whole, block aligned heap blocks
+void* kmalloc_pages(size_t size);
+void* kzalloc_pages(size_t size);
+
+int kheap_get_stats(struct heap_stats* stats);
 
-#endif
\ No newline at end of file
+#endif
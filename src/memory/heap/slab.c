@@ -0,0 +1,188 @@
+#include "slab.h"
+#include "kheap.h"
+#include "../../config.h"
+#include "../memory.h"
+
+static size_t kmem_align_value_to_upper(size_t val, size_t align) {
+    if ((val % align) == 0) {
+        return val;
+    }
+
+    return val - (val % align) + align;
+}
+
+static void kmem_cache_setup(struct kmem_cache* cache) {
+    size_t size = cache->size < sizeof(void*) ? sizeof(void*) : cache->size;
+    cache->object_size = kmem_align_value_to_upper(size, KMEM_SLAB_OBJECT_ALIGN);
+
+    // objects that don't fit next to a slab header get heap blocks of their own
+    if (cache->object_size > KMEM_SLAB_MAX_OBJECT_SIZE) {
+        cache->objects_per_slab = 0;
+        return;
+    }
+
+    cache->objects_per_slab = KMEM_SLAB_MAX_OBJECT_SIZE / cache->object_size;
+}
+
+void kmem_cache_init(struct kmem_cache* cache, const char* name, size_t size) {
+    memset(cache, 0, sizeof(struct kmem_cache));
+    cache->name = name;
+    cache->size = size;
+    kmem_cache_setup(cache);
+}
+
+struct kmem_cache* kmem_cache_create(const char* name, size_t size) {
+    struct kmem_cache* cache = kmalloc(sizeof(struct kmem_cache));
+    if (!cache) {
+        return 0;
+    }
+
+    kmem_cache_init(cache, name, size);
+    return cache;
+}
+
+static void kmem_slab_list_push(struct kmem_slab** list, struct kmem_slab* slab) {
+    slab->prev = 0;
+    slab->next = *list;
+    if (slab->next) {
+        slab->next->prev = slab;
+    }
+    *list = slab;
+}
+
+static void kmem_slab_list_remove(struct kmem_slab** list, struct kmem_slab* slab) {
+    if (slab->prev) {
+        slab->prev->next = slab->next;
+    } else {
+        *list = slab->next;
+    }
+
+    if (slab->next) {
+        slab->next->prev = slab->prev;
+    }
+}
+
+static struct kmem_slab* kmem_slab_of(void* ptr) {
+    return (struct kmem_slab*)((uint32_t)ptr - ((uint32_t)ptr % BENOS_HEAP_BLOCK_SIZE));
+}
+
+static void* kmem_slab_object(struct kmem_slab* slab, uint32_t index) {
+    return (void*)slab + KMEM_SLAB_HEADER_SIZE + (index * slab->cache->object_size);
+}
+
+static struct kmem_slab* kmem_slab_new(struct kmem_cache* cache) {
+    struct kmem_slab* slab = kmalloc_pages(BENOS_HEAP_BLOCK_SIZE);
+    if (!slab) {
+        return 0;
+    }
+
+    // objects are handed out in order, nothing past the header needs to be touched yet
+    memset(slab, 0, sizeof(struct kmem_slab));
+    slab->cache = cache;
+    kmem_slab_list_push(&cache->partial, slab);
+    cache->total_slabs++;
+    return slab;
+}
+
+void* kmem_cache_alloc(struct kmem_cache* cache) {
+    void* ptr = 0;
+    if (!cache->object_size) {
+        // statically defined caches are set up on first use
+        kmem_cache_setup(cache);
+    }
+
+    if (!cache->objects_per_slab) {
+        ptr = kmalloc(cache->size);
+        if (ptr) {
+            cache->total_objects++;
+        }
+        goto out;
+    }
+
+    struct kmem_slab* slab = cache->partial;
+    if (!slab) {
+        slab = kmem_slab_new(cache);
+        if (!slab) {
+            goto out;
+        }
+    }
+
+    if (slab->free) {
+        ptr = slab->free;
+        slab->free = *(void**)ptr;
+    } else {
+        ptr = kmem_slab_object(slab, slab->unused);
+        slab->unused++;
+    }
+
+    slab->in_use++;
+    cache->total_objects++;
+
+    if (slab->in_use == cache->objects_per_slab) {
+        kmem_slab_list_remove(&cache->partial, slab);
+        kmem_slab_list_push(&cache->full, slab);
+    }
+
+out:
+    return ptr;
+}
+
+void* kmem_cache_zalloc(struct kmem_cache* cache) {
+    void* ptr = kmem_cache_alloc(cache);
+    if (!ptr) {
+        return 0;
+    }
+
+    memset(ptr, 0x00, cache->size);
+    return ptr;
+}
+
+void kmem_cache_free(struct kmem_cache* cache, void* ptr) {
+    if (!ptr) {
+        return;
+    }
+
+    if (!cache->objects_per_slab) {
+        kfree(ptr);
+        cache->total_objects--;
+        return;
+    }
+
+    struct kmem_slab* slab = kmem_slab_of(ptr);
+    if (slab->cache != cache) {
+        // not one of our objects
+        return;
+    }
+
+    if (slab->in_use == cache->objects_per_slab) {
+        kmem_slab_list_remove(&cache->full, slab);
+        kmem_slab_list_push(&cache->partial, slab);
+    }
+
+    *(void**)ptr = slab->free;
+    slab->free = ptr;
+    slab->in_use--;
+    cache->total_objects--;
+
+    // give empty slabs back to the heap, but keep the last one so a cache
+    // going back and forth between zero and one object doesn't thrash the heap
+    if (slab->in_use == 0 && (cache->partial != slab || slab->next)) {
+        kmem_slab_list_remove(&cache->partial, slab);
+        cache->total_slabs--;
+        kfree(slab);
+    }
+}
+
+// heap allocations are block aligned, slab objects never are (the header comes first)
+bool kmem_is_slab_object(void* ptr) {
+    return ptr && ((uint32_t)ptr % BENOS_HEAP_BLOCK_SIZE) != 0;
+}
+
+size_t kmem_object_size(void* ptr) {
+    return kmem_slab_of(ptr)->cache->size;
+}
+
+void kmem_free(void* ptr) {
+    struct kmem_slab* slab = kmem_slab_of(ptr);
+    kmem_cache_free(slab->cache, ptr);
+}
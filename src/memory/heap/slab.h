@@ -0,0 +1,63 @@
+#ifndef SLAB_H
+#define SLAB_H
+
+#include "../../config.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// the slab header takes the first cache line of its block, objects follow
+#define KMEM_SLAB_HEADER_SIZE 64
+#define KMEM_SLAB_OBJECT_ALIGN 8
+#define KMEM_SLAB_MAX_OBJECT_SIZE (BENOS_HEAP_BLOCK_SIZE - KMEM_SLAB_HEADER_SIZE)
+
+struct kmem_cache;
+
+// header of a slab (one heap block carved into equally sized objects)
+struct kmem_slab {
+    struct kmem_cache* cache;
+
+    struct kmem_slab* next;
+    struct kmem_slab* prev;
+
+    // objects that were freed back to this slab (linked through their first word)
+    void* free;
+
+    // objects handed out and not freed yet
+    uint32_t in_use;
+
+    // index of the first object that was never handed out
+    uint32_t unused;
+};
+
+struct kmem_cache {
+    const char* name;
+
+    // size of a single object
+    size_t size;
+
+    // size of a single object rounded up to the object alignment
+    size_t object_size;
+    uint32_t objects_per_slab;
+
+    // slabs that have at least one free object
+    struct kmem_slab* partial;
+
+    // slabs that have no free objects left
+    struct kmem_slab* full;
+
+    uint32_t total_slabs;
+    uint32_t total_objects;
+};
+
+struct kmem_cache* kmem_cache_create(const char* name, size_t size);
+void kmem_cache_init(struct kmem_cache* cache, const char* name, size_t size);
+void* kmem_cache_alloc(struct kmem_cache* cache);
+void* kmem_cache_zalloc(struct kmem_cache* cache);
+void kmem_cache_free(struct kmem_cache* cache, void* ptr);
+
+bool kmem_is_slab_object(void* ptr);
+size_t kmem_object_size(void* ptr);
+void kmem_free(void* ptr);
+
+#endif
@@ -1,10 +1,24 @@
 #include "memory.h"
+#include <stdint.h>
 
 void* memset(void* ptr, int c, size_t size) {
     char* char_ptr = (char*) ptr;
 
-    for (size_t i = 0; i < size; i++) {
-        char_ptr[i] = (char) c;
+    // bytes up to the next 4 byte boundary, then whole words, then the leftover bytes
+    while (size && ((uint32_t) char_ptr % 4)) {
+        *char_ptr++ = (char) c;
+        size--;
+    }
+
+    uint32_t word = (uint8_t) c * 0x01010101;
+    uint32_t* word_ptr = (uint32_t*) char_ptr;
+    for (; size >= 4; size -= 4) {
+        *word_ptr++ = word;
+    }
+
+    char_ptr = (char*) word_ptr;
+    while (size--) {
+        *char_ptr++ = (char) c;
     }
     return ptr;
 }
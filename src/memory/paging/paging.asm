@@ -3,7 +3,11 @@
 section .asm
 
 global paging_load_directory
+global paging_invalidate_page
 global enable_paging
+global enable_global_pages
+global enable_large_pages
+global paging_fault_address
 paging_load_directory:
     push ebp,
     mov ebp, esp
@@ -13,6 +17,45 @@ paging_load_directory:
     pop ebp
     ret
 
+; void paging_invalidate_page(void* virt)
+paging_invalidate_page:
+    push ebp
+    mov ebp, esp
+    mov eax, [ebp + 8]
+
+    invlpg [eax]
+    pop ebp
+    ret
+
+; pages marked global stay in the tlb when cr3 changes
+enable_global_pages:
+    push ebp
+    mov ebp, esp
+
+    mov eax, cr4
+    or eax, 0x80 ; cr4.pge
+    mov cr4, eax
+
+    pop ebp
+    ret
+
+; directory entries with the ps bit map 4mb pages
+enable_large_pages:
+    push ebp
+    mov ebp, esp
+
+    mov eax, cr4
+    or eax, 0x10 ; cr4.pse
+    mov cr4, eax
+
+    pop ebp
+    ret
+
+; cr2 holds the address that caused the last page fault
+paging_fault_address:
+    mov eax, cr2
+    ret
+
 enable_paging:
     push ebp
     mov ebp, esp
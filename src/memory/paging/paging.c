@@ -1,45 +1,238 @@
 #include "paging.h"
 #include "../heap/kheap.h"
+#include "../frame.h"
+#include "../memory.h"
 #include "../../status.h"
+#include "../../config.h"
 
 void paging_load_directory(uint32_t* dir);
+void paging_invalidate_page(void* virt);
 static uint32_t* curr_dir = 0;
-struct paging_4gb_chunk* paging_new_4gb(uint8_t flags) {
 
-    uint32_t* dir = kzalloc(sizeof(uint32_t) * PAGING_TOTAL_ENTRIES_PER_TABLE);
-    int offset = 0;
+// every other directory starts out pointing at the page tables of this one
+static uint32_t* kernel_dir = 0;
+
+// directories of exited tasks with their user mappings scrubbed, paging_new_4gb hands these out first
+static struct paging_4gb_chunk* paging_pool[BENOS_PAGING_DIRECTORY_POOL_SIZE];
+static int paging_pool_total = 0;
+
+// builds the identity map of the whole 4gb that all directories share, out of 4mb pages
+struct paging_4gb_chunk* paging_new_kernel_4gb(uint8_t flags) {
+
+    // every entry gets written, so the frame doesn't need zeroing
+    uint32_t* dir = frame_alloc();
     for(int i = 0; i < PAGING_TOTAL_ENTRIES_PER_TABLE; i++) {
-        uint32_t* entry = kzalloc(sizeof(uint32_t) * PAGING_TOTAL_ENTRIES_PER_TABLE);
-        for (int b = 0; b < PAGING_TOTAL_ENTRIES_PER_TABLE; b++) {
-            entry[b] = (offset + (b * PAGING_PAGE_SIZE)) | flags;
-        }
+        dir[i] = (i * PAGING_LARGE_PAGE_SIZE) | flags | PAGING_IS_LARGE;
+    }
+
+    struct paging_4gb_chunk* chunk = kzalloc(sizeof(struct paging_4gb_chunk));
+    chunk->directory_entry = dir;
+    kernel_dir = dir;
+    return chunk;
+    //created a page directory that covers the entire 4gb of ram
+}
 
-        offset += (PAGING_TOTAL_ENTRIES_PER_TABLE * PAGING_PAGE_SIZE);
-        dir[i] = (uint32_t)entry | flags | PAGING_IS_WRITABLE;
+// a directory that shares all of the kernel's mappings, paging_set gives it private tables as it maps
+struct paging_4gb_chunk* paging_new_4gb() {
+    if (paging_pool_total > 0) {
+        return paging_pool[--paging_pool_total];
     }
 
     struct paging_4gb_chunk* chunk = kzalloc(sizeof(struct paging_4gb_chunk));
+    if (!chunk) {
+        return 0;
+    }
+
+    uint32_t* dir = frame_alloc();
+    if (!dir) {
+        kfree(chunk);
+        return 0;
+    }
+
+    memcpy(dir, kernel_dir, PAGING_TOTAL_ENTRIES_PER_TABLE * sizeof(uint32_t));
     chunk->directory_entry = dir;
     return chunk;
-    //created a page directory with page tables that cover the entire 4gb of ram
+}
+
+static uint32_t* paging_dir_entry_table(uint32_t entry) {
+    return (uint32_t*)(entry & 0xFFFFF000);
+}
+
+static bool paging_is_large(uint32_t entry) {
+    return entry & PAGING_IS_LARGE;
+}
+
+static bool paging_is_shared_table(uint32_t* dir, uint32_t dir_i) {
+    return dir != kernel_dir && dir[dir_i] == kernel_dir[dir_i];
+}
+
+// the table entry a 4mb page stands for at table_i
+static uint32_t paging_large_to_entry(uint32_t entry, uint32_t table_i) {
+    return ((entry & 0xFFC00000) + table_i * PAGING_PAGE_SIZE) | (entry & PAGING_LARGE_ENTRY_FLAGS);
+}
+
+// 4kb table that maps the same as the 4mb page in entry
+static uint32_t* paging_split_large(uint32_t entry) {
+    uint32_t* table = frame_alloc();
+    if (!table) {
+        return 0;
+    }
+
+    for (int i = 0; i < PAGING_TOTAL_ENTRIES_PER_TABLE; i++) {
+        table[i] = paging_large_to_entry(entry, i);
+    }
+
+    return table;
 }
 
 void paging_switch(struct paging_4gb_chunk* directory) {
+    // reloading cr3 flushes the tlb, don't do it for nothing
+    if (curr_dir == directory->directory_entry) {
+        return;
+    }
+
     paging_load_directory(directory->directory_entry);
     curr_dir = directory->directory_entry;
 }
 
+// puts the kernel's mapping back wherever the directory differs from it, the private tables stay (zeroing
+// them costs as much as splitting them again), so the next task mapping the same ranges skips that work
+static void paging_scrub(uint32_t* dir) {
+    for (int i = 0; i < PAGING_TOTAL_ENTRIES_PER_TABLE; i++) {
+        if (dir[i] == kernel_dir[i]) {
+            continue;
+        }
+
+        if (paging_is_large(dir[i])) {
+            dir[i] = kernel_dir[i];
+            continue;
+        }
+
+        uint32_t* table = paging_dir_entry_table(dir[i]);
+        uint32_t* kernel_table = paging_is_large(kernel_dir[i]) ? 0 : paging_dir_entry_table(kernel_dir[i]);
+        for (int j = 0; j < PAGING_TOTAL_ENTRIES_PER_TABLE; j++) {
+            table[j] = kernel_table ? kernel_table[j] : paging_large_to_entry(kernel_dir[i], j);
+        }
+    }
+}
+
 void paging_free_4gb(struct paging_4gb_chunk* chunk) {
-    for (int i = 0; i < 1024; i++) {
-        uint32_t entry = chunk->directory_entry[i];
-        uint32_t* table = (uint32_t*)(entry & 0xFFFFF000);
-        kfree(table);
+    // a task that exits is still running on its directory, get off it before its frames are reused
+    if (curr_dir == chunk->directory_entry) {
+        paging_load_directory(kernel_dir);
+        curr_dir = kernel_dir;
     }
 
-    kfree(chunk->directory_entry);
+    // the kernel directory doesn't change once tasks exist, so a scrubbed directory maps the same as a new one
+    // (it still holds its private tables, whoever fills it in wholesale reuses or frees them)
+    if (paging_pool_total < BENOS_PAGING_DIRECTORY_POOL_SIZE) {
+        paging_scrub(chunk->directory_entry);
+        paging_pool[paging_pool_total++] = chunk;
+        return;
+    }
+
+    // only the tables this directory got for itself, the kernel's stay and 4mb pages have no table
+    for (int i = 0; i < PAGING_TOTAL_ENTRIES_PER_TABLE; i++) {
+        if (paging_is_shared_table(chunk->directory_entry, i) || paging_is_large(chunk->directory_entry[i])) {
+            continue;
+        }
+
+        frame_free(paging_dir_entry_table(chunk->directory_entry[i]));
+    }
+
+    frame_free(chunk->directory_entry);
     kfree(chunk);
 }
 
+// gives back the frame reference every user page of the directory holds, right before the directory is freed
+void paging_free_user_frames(struct paging_4gb_chunk* chunk) {
+    uint32_t* dir = chunk->directory_entry;
+    for (int i = 0; i < PAGING_TOTAL_ENTRIES_PER_TABLE; i++) {
+        uint32_t entry = dir[i];
+        if (paging_is_shared_table(dir, i) || !(entry & PAGING_IS_PRESENT)) {
+            continue;
+        }
+
+        if (paging_is_large(entry)) {
+            if (entry & PAGING_ACCESS_FROM_ALL) {
+                frame_free_contiguous((void*)(entry & 0xFFC00000), PAGING_TOTAL_ENTRIES_PER_TABLE);
+            }
+            continue;
+        }
+
+        uint32_t* table = paging_dir_entry_table(entry);
+        for (int j = 0; j < PAGING_TOTAL_ENTRIES_PER_TABLE; j++) {
+            if ((table[j] & PAGING_IS_PRESENT) && (table[j] & PAGING_ACCESS_FROM_ALL)) {
+                frame_free((void*)(table[j] & 0xFFFFF000));
+            }
+        }
+    }
+}
+
+// user pages that may be written turn read only and copy on write
+static uint32_t paging_entry_to_cow(uint32_t entry) {
+    if (entry & PAGING_IS_WRITABLE) {
+        entry = (entry & ~PAGING_IS_WRITABLE) | PAGING_IS_COW;
+    }
+    return entry;
+}
+
+// shares every user page of from with to (a new or pooled directory), both copy a writable page the first time they write to it
+int paging_share_copy_on_write(struct paging_4gb_chunk* from, struct paging_4gb_chunk* to) {
+    uint32_t* src = from->directory_entry;
+    uint32_t* dst = to->directory_entry;
+    int res = 0;
+    for (int i = 0; i < PAGING_TOTAL_ENTRIES_PER_TABLE; i++) {
+        uint32_t entry = src[i];
+        if (paging_is_shared_table(src, i)) {
+            continue;
+        }
+
+        // a pooled directory may still have a private table here, it's overwritten below
+        uint32_t* old_table = 0;
+        if (!paging_is_shared_table(dst, i) && !paging_is_large(dst[i])) {
+            old_table = paging_dir_entry_table(dst[i]);
+        }
+
+        if (paging_is_large(entry)) {
+            if (old_table) {
+                frame_free(old_table);
+            }
+
+            if (entry & PAGING_ACCESS_FROM_ALL) {
+                entry = paging_entry_to_cow(entry);
+                frame_ref_contiguous((void*)(entry & 0xFFC00000), PAGING_TOTAL_ENTRIES_PER_TABLE);
+                src[i] = entry;
+            }
+            dst[i] = entry;
+            continue;
+        }
+
+        uint32_t* table = paging_dir_entry_table(entry);
+        uint32_t* copy = old_table ? old_table : frame_alloc();
+        if (!copy) {
+            res = -ENOMEM;
+            break;
+        }
+
+        for (int j = 0; j < PAGING_TOTAL_ENTRIES_PER_TABLE; j++) {
+            if ((table[j] & PAGING_IS_PRESENT) && (table[j] & PAGING_ACCESS_FROM_ALL)) {
+                table[j] = paging_entry_to_cow(table[j]);
+                frame_ref((void*)(table[j] & 0xFFFFF000));
+            }
+            copy[j] = table[j];
+        }
+        dst[i] = (uint32_t)copy | (entry & 0xFFF);
+    }
+
+    // the tlb may still allow writes to pages that just turned read only
+    if (src == curr_dir) {
+        paging_load_directory(curr_dir);
+    }
+
+    return res;
+}
+
 uint32_t* paging_4g_chunk_get_dir(struct paging_4gb_chunk* chunk) {
     return chunk->directory_entry;
 }
@@ -89,9 +282,41 @@ int paging_map(struct paging_4gb_chunk* dir, void* virt, void* phys, int flags)
     return paging_set(dir->directory_entry, virt, (uint32_t)phys | flags);
 }
 
+// whole 4mb stretches where both sides are 4mb aligned get a single directory entry
+static bool paging_can_map_large(void* virt, void* phys, int count) {
+    return count >= PAGING_TOTAL_ENTRIES_PER_TABLE
+        && ((uint32_t)virt % PAGING_LARGE_PAGE_SIZE) == 0
+        && ((uint32_t)phys % PAGING_LARGE_PAGE_SIZE) == 0;
+}
+
+static int paging_map_large(struct paging_4gb_chunk* dir, void* virt, void* phys, int flags) {
+    uint32_t dir_i = (uint32_t)virt / PAGING_LARGE_PAGE_SIZE;
+    uint32_t entry = dir->directory_entry[dir_i];
+
+    // a table of its own gets replaced completely
+    if (!paging_is_shared_table(dir->directory_entry, dir_i) && !paging_is_large(entry)) {
+        frame_free(paging_dir_entry_table(entry));
+    }
+
+    dir->directory_entry[dir_i] = (uint32_t)phys | flags | PAGING_IS_LARGE;
+    if (dir->directory_entry == curr_dir) {
+        paging_invalidate_page(virt);
+    }
+
+    return 0;
+}
+
 int paging_map_range(struct paging_4gb_chunk* dir, void* virt, void* phys, int count, int flags) {
     int res = 0;
-    for (int i = 0; i < count; i++) {
+    while (count > 0) {
+        if (paging_can_map_large(virt, phys, count)) {
+            res = paging_map_large(dir, virt, phys, flags);
+            virt += PAGING_LARGE_PAGE_SIZE;
+            phys += PAGING_LARGE_PAGE_SIZE;
+            count -= PAGING_TOTAL_ENTRIES_PER_TABLE;
+            continue;
+        }
+
         res = paging_map(dir, virt, phys, flags);
         if (res < 0) {
             break;
@@ -99,12 +324,12 @@ int paging_map_range(struct paging_4gb_chunk* dir, void* virt, void* phys, int c
 
         virt += PAGING_PAGE_SIZE;
         phys += PAGING_PAGE_SIZE;
+        count--;
     }
 
     return res;
 }
 
-
 int paging_map_to(struct paging_4gb_chunk* dir, void* virt, void* phys, void* phys_end, int flags) {
     int res = 0;
     if ((uint32_t)virt % PAGING_PAGE_SIZE != 0) {
@@ -151,12 +376,95 @@ int paging_set(uint32_t* dir, void* virt, uint32_t val) {
     }
 
     uint32_t entry = dir[dir_i];
-    uint32_t* table = (uint32_t*)(entry & 0xFFFFF000);
+    if (paging_get(dir, virt) == val) {
+        return 0;
+    }
+
+    uint32_t* table = paging_dir_entry_table(entry);
+    if (paging_is_large(entry)) {
+        // a single page inside a 4mb page, break it up into a table
+        table = paging_split_large(entry);
+        if (!table) {
+            return -ENOMEM;
+        }
+    } else if (paging_is_shared_table(dir, dir_i)) {
+        // first change in a range the directory shares with the kernel, give it its own copy of the table
+        uint32_t* private_table = frame_alloc();
+        if (!private_table) {
+            return -ENOMEM;
+        }
+
+        memcpy(private_table, table, PAGING_TOTAL_ENTRIES_PER_TABLE * sizeof(uint32_t));
+        table = private_table;
+    }
+
+    if (table != paging_dir_entry_table(entry)) {
+        // the table entries decide what the user may touch (the kernel's own tables stay supervisor only)
+        uint32_t dir_flags = PAGING_IS_PRESENT | PAGING_IS_WRITABLE;
+        if (dir != kernel_dir) {
+            dir_flags |= PAGING_ACCESS_FROM_ALL;
+        }
+        dir[dir_i] = (uint32_t)table | dir_flags;
+    }
+
     table[table_i] = val;
 
+    // interrupts and system calls run on the task's directory, so the change can be live already
+    if (dir == curr_dir) {
+        paging_invalidate_page(virt);
+    }
+
     return 0;
 }
 
+// gives the pages in [virt, virt_end) back the kernel's mapping
+int paging_unmap_to(struct paging_4gb_chunk* dir, void* virt, void* virt_end) {
+    int res = 0;
+    if (!paging_is_alligned(virt) || !paging_is_alligned(virt_end)) {
+        return -EINVARG;
+    }
+
+    while (virt < virt_end) {
+        uint32_t dir_i = (uint32_t)virt / PAGING_LARGE_PAGE_SIZE;
+        if (((uint32_t)virt % PAGING_LARGE_PAGE_SIZE) == 0 && virt_end - virt >= PAGING_LARGE_PAGE_SIZE) {
+            // the whole 4mb goes back to the kernel's entry, no need to split or copy anything
+            if (!paging_is_shared_table(dir->directory_entry, dir_i) && !paging_is_large(dir->directory_entry[dir_i])) {
+                frame_free(paging_dir_entry_table(dir->directory_entry[dir_i]));
+            }
+            dir->directory_entry[dir_i] = kernel_dir[dir_i];
+            if (dir->directory_entry == curr_dir) {
+                paging_invalidate_page(virt);
+            }
+            virt += PAGING_LARGE_PAGE_SIZE;
+            continue;
+        }
+
+        res = paging_set(dir->directory_entry, virt, paging_get(kernel_dir, virt));
+        if (res < 0) {
+            break;
+        }
+        virt += PAGING_PAGE_SIZE;
+    }
+
+    return res;
+}
+
+// for kernel memory that is mapped the same way in every directory
+void paging_mark_global(struct paging_4gb_chunk* chunk, void* start, void* end) {
+    void* virt = paging_align_to_lower_page(start);
+    while (virt < end) {
+        uint32_t* entry = &chunk->directory_entry[(uint32_t)virt / PAGING_LARGE_PAGE_SIZE];
+        if (paging_is_large(*entry) && ((uint32_t)virt % PAGING_LARGE_PAGE_SIZE) == 0 && end - virt >= PAGING_LARGE_PAGE_SIZE) {
+            *entry |= PAGING_IS_GLOBAL;
+            virt += PAGING_LARGE_PAGE_SIZE;
+            continue;
+        }
+
+        paging_set(chunk->directory_entry, virt, paging_get(chunk->directory_entry, virt) | PAGING_IS_GLOBAL);
+        virt += PAGING_PAGE_SIZE;
+    }
+}
+
 void* paging_get_phys_addr(uint32_t* dir, void* virt) {
     void* virt_addr_new = (void*) paging_align_to_lower_page(virt);
     void* diff = (void*)((uint32_t)virt - (uint32_t)virt_addr_new);
@@ -170,6 +478,10 @@ uint32_t paging_get(uint32_t* dir, void* virt) {
 
     paging_get_indexes(virt, &dir_i, &table_i);
     uint32_t entry = dir[dir_i];
+    if (paging_is_large(entry)) {
+        return paging_large_to_entry(entry, table_i);
+    }
+
     uint32_t* table = (uint32_t*)(entry & 0xFFFFF000);
     return table[table_i];
 }
\ No newline at end of file
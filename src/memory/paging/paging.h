@@ -5,28 +5,50 @@
 #include <stddef.h>
 #include <stdbool.h>
 
+// one of the bits the cpu leaves to the os, the page is shared read only until someone writes to it
+#define PAGING_IS_COW          0b1000000000
+#define PAGING_IS_GLOBAL       0b100000000
+// directory entry maps a 4mb page instead of pointing at a table (needs cr4.pse)
+#define PAGING_IS_LARGE        0b010000000
 #define PAGING_CACHE_DISABLED  0b00010000
 #define PAGING_WRITE_THROUGH   0b00001000
 #define PAGING_ACCESS_FROM_ALL 0b00000100
 #define PAGING_IS_WRITABLE     0b00000010
 #define PAGING_IS_PRESENT      0b00000001
 
+// page fault error code bits
+#define PAGING_FAULT_PRESENT   0b001
+#define PAGING_FAULT_WRITE     0b010
+#define PAGING_FAULT_USER      0b100
+
 #define PAGING_TOTAL_ENTRIES_PER_TABLE 1024
 #define PAGING_PAGE_SIZE 4096
+#define PAGING_LARGE_PAGE_SIZE (PAGING_TOTAL_ENTRIES_PER_TABLE * PAGING_PAGE_SIZE)
+
+// flags a 4mb page passes on to the table entries when it's split
+#define PAGING_LARGE_ENTRY_FLAGS (PAGING_IS_COW | PAGING_IS_GLOBAL | PAGING_CACHE_DISABLED | PAGING_WRITE_THROUGH | PAGING_ACCESS_FROM_ALL | PAGING_IS_WRITABLE | PAGING_IS_PRESENT)
 
 struct paging_4gb_chunk {
     uint32_t* directory_entry;
 };
 
-struct paging_4gb_chunk* paging_new_4gb(uint8_t flags);
+struct paging_4gb_chunk* paging_new_kernel_4gb(uint8_t flags);
+struct paging_4gb_chunk* paging_new_4gb();
 void paging_switch(struct paging_4gb_chunk* directory);
 void enable_paging();
+void enable_global_pages();
+void enable_large_pages();
+void* paging_fault_address();
+void paging_mark_global(struct paging_4gb_chunk* chunk, void* start, void* end);
+int paging_unmap_to(struct paging_4gb_chunk* dir, void* virt, void* virt_end);
 
 int paging_set(uint32_t* dir, void* virt, uint32_t val);
 bool paging_is_alligned(void* addr);
 
 uint32_t* paging_4g_chunk_get_dir(struct paging_4gb_chunk* chunk);
 void paging_free_4gb(struct paging_4gb_chunk* chunk);
+void paging_free_user_frames(struct paging_4gb_chunk* chunk);
+int paging_share_copy_on_write(struct paging_4gb_chunk* from, struct paging_4gb_chunk* to);
 
 int paging_map_to(struct paging_4gb_chunk* dir, void* virt, void* phys, void* phys_end, int flags);
 int paging_map_range(struct paging_4gb_chunk* dir, void* virt, void* phys, int count, int flags);
@@ -3,11 +3,15 @@
 #include "../status.h"
 #include "../memory/memory.h"
 #include "../memory/heap/kheap.h"
+#include "../memory/heap/slab.h"
+#include "../memory/frame.h"
 #include "../fs/file.h"
 #include "../string/string.h"
 #include "../kernel.h"
 #include "../memory/paging/paging.h"
 #include "../loader/formats/elfloader.h"
+#include "sched.h"
+#include "../idt/clock.h"
 
 
 
@@ -16,6 +20,8 @@ static struct process* curr_process = 0;
 
 static struct process* processes[BENOS_MAX_PROCESSES] = {};
 
+static struct kmem_cache process_cache = {.name = "process", .size = sizeof(struct process)};
+
 static void process_init(struct process* process) {
     memset(process, 0, sizeof(struct process));
 }
@@ -38,86 +44,164 @@ int process_switch(struct process* proc) {
     return 0;
 }
 
-static int process_find_free_alloc_index(struct process* process) {
-    int res = -ENOMEM;
-    for (int i = 0; i < BENOS_MAX_PROGRAM_ALLOCATIONS; i++) {
-        if (process->allocations[i].ptr == 0) {
-            res = i;
-            break;
+#define PROCESS_MALLOC_ADDRESS (BENOS_PROGRAM_VIRTUAL_HEAP_ADDRESS + BENOS_PROGRAM_VIRTUAL_BRK_SIZE)
+#define PROCESS_MALLOC_SIZE (BENOS_PROGRAM_VIRTUAL_HEAP_SIZE - BENOS_PROGRAM_VIRTUAL_BRK_SIZE)
+// room for this many allocations when a process reserves its first one, doubled whenever it runs out
+#define PROCESS_MIN_ALLOCATIONS 16
+
+// first byte after the pages an allocation covers, empty allocations still take a page
+static void* process_allocation_end(void* ptr, size_t size) {
+    return paging_align_address(ptr + (size ? size : 1));
+}
+
+// index of the first allocation that starts above virt, the allocations are sorted by address
+static int process_allocation_search(struct process* process, void* virt) {
+    int low = 0;
+    int high = process->total_allocations;
+    while (low < high) {
+        int middle = (low + high) / 2;
+        if (process->allocations[middle].ptr <= virt) {
+            low = middle + 1;
+        } else {
+            high = middle;
         }
     }
 
-    return res;
+    return low;
 }
 
-void* process_malloc(struct process* process, size_t size) {
-    void* ptr = kzalloc(size);
-    if (!ptr) {
-        goto out_err;
+// index of the allocation whose pages cover virt, -EFAULT if there's none
+static int process_allocation_index_containing(struct process* process, void* virt) {
+    int index = process_allocation_search(process, virt) - 1;
+    if (index < 0) {
+        return -EFAULT;
+    }
+
+    struct process_allocation* allocation = &process->allocations[index];
+    if (virt >= process_allocation_end(allocation->ptr, allocation->size)) {
+        return -EFAULT;
     }
 
-    int index = process_find_free_alloc_index(process);
+    return index;
+}
 
-    if (index < 0) {
-        goto out_err;
+// allocation whose pages cover virt
+static struct process_allocation* process_get_allocation_containing(struct process* process, void* virt) {
+    int index = process_allocation_index_containing(process, virt);
+    return index < 0 ? 0 : &process->allocations[index];
+}
+
+static int process_allocation_insert(struct process* process, int index, void* ptr, size_t size) {
+    if (process->total_allocations == process->max_allocations) {
+        int max_allocations = process->max_allocations ? process->max_allocations * 2 : PROCESS_MIN_ALLOCATIONS;
+        struct process_allocation* allocations = krealloc(process->allocations, max_allocations * sizeof(struct process_allocation));
+        if (!allocations) {
+            return -ENOMEM;
+        }
+
+        process->allocations = allocations;
+        process->max_allocations = max_allocations;
     }
 
-    int res = paging_map_to(process->task->page_directory, ptr, ptr, paging_align_address(ptr + size), PAGING_IS_WRITABLE | PAGING_IS_PRESENT | PAGING_ACCESS_FROM_ALL);
-    
-    if (res < 0) {
-        goto out_err;
+    for (int i = process->total_allocations; i > index; i--) {
+        process->allocations[i] = process->allocations[i - 1];
     }
-    
+
     process->allocations[index].ptr = ptr;
     process->allocations[index].size = size;
-    return ptr;
+    process->total_allocations++;
+    return 0;
+}
 
-out_err:
-    if (ptr) {
-        kfree(ptr);
+static void process_allocation_remove(struct process* process, int index) {
+    process->total_allocations--;
+    for (int i = index; i < process->total_allocations; i++) {
+        process->allocations[i] = process->allocations[i + 1];
     }
-    return 0;
 }
 
-static bool process_is_process_pointer(struct process* process, void* ptr) {
-    for (int i = 0; i < BENOS_MAX_PROGRAM_ALLOCATIONS; i++) {
-        if (process->allocations[i].ptr == ptr) {
-            return true;
-        }
+// the child reserves the same addresses as the parent
+static int process_copy_allocations(struct process* from, struct process* to) {
+    if (!from->total_allocations) {
+        return 0;
     }
 
-    return false;
+    to->allocations = kmalloc(from->total_allocations * sizeof(struct process_allocation));
+    if (!to->allocations) {
+        return -ENOMEM;
+    }
+
+    memcpy(to->allocations, from->allocations, from->total_allocations * sizeof(struct process_allocation));
+    to->total_allocations = from->total_allocations;
+    to->max_allocations = from->total_allocations;
+    return 0;
 }
 
-static void process_allocation_ujoin(struct process* process, void* ptr) {
-    for (int i = 0; i < BENOS_MAX_PROGRAM_ALLOCATIONS; i++) {
-        if (process->allocations[i].ptr == ptr) {
-            process->allocations[i].ptr = 0x00;
-            process->allocations[i].size = 0x00;
+// drops the bookkeeping only, the pages go with the directory
+static void process_free_allocations(struct process* process) {
+    kfree(process->allocations);
+    process->allocations = 0;
+    process->total_allocations = 0;
+    process->max_allocations = 0;
+}
+
+// first gap in the user heap window (behind the program break's range) that fits size bytes of whole pages,
+// index is where an allocation at the gap goes
+static void* process_find_heap_gap(struct process* process, size_t size, int* index) {
+    void* start = (void*)PROCESS_MALLOC_ADDRESS;
+    size_t length = process_allocation_end(0, size) - (void*)0;
+    if (size > PROCESS_MALLOC_SIZE) {
+        return 0;
+    }
+
+    int i = 0;
+    for (; i < process->total_allocations; i++) {
+        struct process_allocation* allocation = &process->allocations[i];
+        if ((uint32_t)(allocation->ptr - start) >= length) {
+            break;
         }
+
+        start = process_allocation_end(allocation->ptr, allocation->size);
     }
+
+    if ((uint32_t)(start - PROCESS_MALLOC_ADDRESS) > PROCESS_MALLOC_SIZE - length) {
+        return 0;
+    }
+
+    *index = i;
+    return start;
 }
 
-static struct process_allocation* process_get_allocation_by_addr(struct process* process, void* ptr) {
-    for (int i = 0; i < BENOS_MAX_PROGRAM_ALLOCATIONS; i++) {
-        if (process->allocations[i].ptr == ptr) {
-            return &process->allocations[i];
-        }
+// only reserves the addresses, the frames come from the page fault handler when the process touches them
+void* process_malloc(struct process* process, size_t size) {
+    int index = 0;
+    void* ptr = process_find_heap_gap(process, size, &index);
+    if (!ptr) {
+        return 0;
     }
 
-    return 0;
+    if (process_allocation_insert(process, index, ptr, size) < 0) {
+        return 0;
+    }
+
+    return ptr;
 }
 
-int process_terminate_allocations(struct process* process) {
-    for (int i = 0; i < BENOS_MAX_PROGRAM_ALLOCATIONS; i++) {
-        process_free(process, process->allocations[i].ptr);
+// gives back the frames the process got on first touch in [start, end) and unmaps the range
+static int process_release_range(struct process* process, void* start, void* end) {
+    uint32_t* dir = process->task->page_directory->directory_entry;
+    for (void* virt = start; virt < end; virt += PAGING_PAGE_SIZE) {
+        uint32_t entry = paging_get(dir, virt);
+        if ((entry & PAGING_IS_PRESENT) && (entry & PAGING_ACCESS_FROM_ALL)) {
+            frame_free((void*)(entry & 0xFFFFF000));
+        }
     }
 
-    return 0;
+    return paging_unmap_to(process->task->page_directory, start, end);
 }
 
 int process_free_binary_data(struct process* process) {
-    kfree(process->ptr);
+    frame_free_contiguous(process->ptr, frame_size_to_frames(process->size));
     return 0;
 }
 
@@ -162,20 +246,25 @@ static void process_unlink(struct process* process) {
     }
 }
 
+// the part of an elf segment past its file data, page aligned
+static void process_elf_bss_range(struct elf32_phdr* phdr, void** start, void** end) {
+    *start = phdr->p_filesz ? paging_align_address((void*)(phdr->p_vaddr + phdr->p_filesz)) : paging_align_to_lower_page((void*)phdr->p_vaddr);
+    *end = paging_align_address((void*)(phdr->p_vaddr + phdr->p_memsz));
+}
+
 int process_terminate(struct process* process) {
     
     int res = 0;
-    res = process_terminate_allocations(process);
-    if (res < 0) {
-        goto out;
-    }
+
+    // every mapped user page (image, heap, stack, bss) holds a reference on its frame
+    paging_free_user_frames(process->task->page_directory);
 
     res = process_free_progran_data(process);
     if (res < 0) {
         goto out;
     }
-    // free the process stack memory
-    kfree(process->stack);
+
+    process_free_allocations(process);
 
     // free the process task
     task_free(process->task);
@@ -184,6 +273,8 @@ int process_terminate(struct process* process) {
 
     print("Process was terminated");
 
+    kmem_cache_free(&process_cache, process);
+
 out:
     return res;
 }
@@ -204,38 +295,56 @@ int process_count_command_args(struct command_arg* root_arg) {
     return res;
 }
 
+// writes size bytes into the process's memory a page at a time
+// lays out argc, argv (null terminated), an empty envp and the strings at the top of the stack like the
+// sysv i386 abi does, in a single copy, and starts the task with its stack pointer on argc
 int process_inject_args(struct process* process, struct command_arg* root_arg) {
     int res = 0;
-    struct command_arg* current = root_arg;
-    int i = 0;
     int argc = process_count_command_args(root_arg);
 
-    if (argc == 0) {
-        res = -EIO;
+    size_t strings_size = 0;
+    for (struct command_arg* current = root_arg; current; current = current->next) {
+        strings_size += strnlen(current->arg, sizeof(current->arg)) + 1;
+    }
+
+    size_t table_size = sizeof(uint32_t) * (argc + 3);
+    size_t size = (table_size + strings_size + 15) & ~15;
+    if (size > BENOS_USER_PROGRAM_ARGS_MAX) {
+        res = -EINVARG;
         goto out;
     }
 
-    char **argv = process_malloc(process, sizeof(const char*) * argc);
-    if (!argv) {
+    uint32_t* image = kzalloc(size);
+    if (!image) {
         res = -ENOMEM;
         goto out;
     }
 
-    while (current) {
-        char* arg_str = process_malloc(process, sizeof(current->arg));
-        if (!arg_str) {
-            res = -ENOMEM;
-            goto out;
-        }
+    void* stack = (void*)BENOS_PROGRAM_VIRTUAL_STACK_ADDRESS_START - size;
+    char* strings = (char*)image + table_size;
+    char* user_strings = stack + table_size;
+    int i = 0;
+    image[i++] = argc;
+    for (struct command_arg* current = root_arg; current; current = current->next) {
+        int length = strnlen(current->arg, sizeof(current->arg));
+        memcpy(strings, current->arg, length);
+        image[i++] = (uint32_t)user_strings;
+        strings += length + 1;
+        user_strings += length + 1;
+    }
 
-        strncpy(arg_str, current->arg, sizeof(current->arg));
-        argv[i] = arg_str;
-        current = current->next;
-        i++;
+    // the argv and envp terminators are already zero
+
+    // the pages under the new stack pointer count as stack growth
+    process->task->registers.esp = (uint32_t)stack;
+    res = copy_to_user(process->task, stack, image, size);
+    kfree(image);
+    if (res < 0) {
+        goto out;
     }
 
     process->args.argc = argc;
-    process->args.argv = argv;
+    process->args.argv = stack + sizeof(uint32_t);
 
 out:
     return res;
@@ -244,13 +353,15 @@ out:
 void process_free(struct process* process, void* ptr) {
 
     //unlink the pages from the process for the given address
-    struct process_allocation* allocation = process_get_allocation_by_addr(process, ptr);
-    if (!allocation) {
+    int index = ptr ? process_allocation_index_containing(process, ptr) : -EFAULT;
+    if (index < 0 || process->allocations[index].ptr != ptr) {
         //not our pointer!
         return;
     }
 
-    int res = paging_map_to(process->task->page_directory, allocation->ptr, allocation->ptr, paging_align_address(allocation->ptr + allocation->size), 0x00);
+    // free the frames of the pages that were touched
+    struct process_allocation* allocation = &process->allocations[index];
+    int res = process_release_range(process, allocation->ptr, process_allocation_end(allocation->ptr, allocation->size));
 
     if (res < 0) {
         //failed to unmap the pages
@@ -258,10 +369,42 @@ void process_free(struct process* process, void* ptr) {
     }
 
     // unjoin the allocation
-    process_allocation_ujoin(process, ptr);
+    process_allocation_remove(process, index);
+}
+
+// moves the program break and returns the old one (0 if it can't move that far), pages below the break are
+// mapped on first touch and the pages a shrinking break leaves behind are given back
+void* process_sbrk(struct process* process, int increment) {
+    void* start = (void*)BENOS_PROGRAM_VIRTUAL_HEAP_ADDRESS;
+    void* old_brk = process->brk;
+    if (increment > 0 && (uint32_t)increment > (uint32_t)(start + BENOS_PROGRAM_VIRTUAL_BRK_SIZE - old_brk)) {
+        return 0;
+    }
+
+    if (increment < 0 && -(uint32_t)increment > (uint32_t)(old_brk - start)) {
+        return 0;
+    }
+
+    void* new_brk = old_brk + increment;
+    if (increment < 0 && process_release_range(process, paging_align_address(new_brk), paging_align_address(old_brk)) < 0) {
+        return 0;
+    }
 
-    // free the pointer
-    kfree(ptr);
+    process->brk = new_brk;
+    return old_brk;
+}
+
+// images of 4mb or more start on a 4mb frame so paging can map them with 4mb pages
+static void* process_image_alloc(size_t size) {
+    uint32_t total_frames = frame_size_to_frames(size);
+    if (size >= PAGING_LARGE_PAGE_SIZE) {
+        void* ptr = frame_zalloc_contiguous_aligned(total_frames, PAGING_LARGE_PAGE_SIZE);
+        if (ptr) {
+            return ptr;
+        }
+    }
+
+    return frame_zalloc_contiguous(total_frames);
 }
 
 static int process_load_binary(const char* fname, struct process* process) {
@@ -281,7 +424,7 @@ static int process_load_binary(const char* fname, struct process* process) {
         goto out;
     }
 
-    program_data_ptr = kzalloc(stat.size);
+    program_data_ptr = process_image_alloc(stat.size);
     if (!program_data_ptr) {
         res = -ENOMEM;
         goto out;
@@ -299,7 +442,7 @@ static int process_load_binary(const char* fname, struct process* process) {
 out:
     if (res < 0) {
         if (program_data_ptr) {
-            kfree(program_data_ptr);
+            frame_free_contiguous(program_data_ptr, frame_size_to_frames(stat.size));
         }
     }
     fclose(fd);
@@ -330,28 +473,62 @@ static int process_load_data(const char* fname, struct process* process) {
     return res;
 }
 
+// the mapping holds its own reference on the image frames, the loader's is dropped when the program data is freed
 int process_map_binary(struct process* process) {
     int res = 0;
-    paging_map_to(process->task->page_directory, (void*) BENOS_PROGRAM_VIRTUAL_ADDRESS, process->ptr, paging_align_address(process->ptr + process->size), PAGING_IS_PRESENT | PAGING_ACCESS_FROM_ALL | PAGING_IS_WRITABLE);
+    res = paging_map_to(process->task->page_directory, (void*) BENOS_PROGRAM_VIRTUAL_ADDRESS, process->ptr, paging_align_address(process->ptr + process->size), PAGING_IS_PRESENT | PAGING_ACCESS_FROM_ALL | PAGING_IS_WRITABLE);
+    if (res < 0) {
+        return res;
+    }
+
+    frame_ref_contiguous(process->ptr, frame_size_to_frames(process->size));
     return res; 
 }
 
+// the elf image is cached and shared by every instance, so a writable segment gets its own copy of the file data
+static int process_map_elf_private(struct process* process, struct elf_segment* segment, int flags) {
+    int res = 0;
+    void* virt = paging_align_to_lower_page((void*)segment->phdr.p_vaddr);
+    for (uint32_t i = 0; i < segment->total_pages; i++) {
+        void* frame = frame_alloc();
+        if (!frame) {
+            res = -ENOMEM;
+            break;
+        }
+
+        memcpy(frame, segment->mem + i * PAGING_PAGE_SIZE, PAGING_PAGE_SIZE);
+        res = paging_map(process->task->page_directory, virt + i * PAGING_PAGE_SIZE, frame, flags);
+        if (res < 0) {
+            frame_free(frame);
+            break;
+        }
+    }
+
+    return res;
+}
+
+// only the pages with file data get mapped, the bss behind them is filled in on first touch
 static int process_map_elf(struct process* process) {
     int res = 0;
     struct elf_file* elf_file = process->elf;
-    struct elf_header* header = elf_header(elf_file);
-    struct elf32_phdr* phdrs = elf_pheader(header);
-    for (int i = 0; i < header->e_phnum; i++) {
-        struct elf32_phdr* phdr = &phdrs[i];
-        void* phdr_phys_address = elf_phdr_phys_address(elf_file, phdr);
+    for (int i = 0; i < elf_total_segments(elf_file); i++) {
+        struct elf_segment* segment = elf_segment(elf_file, i);
         int flags = PAGING_IS_PRESENT | PAGING_ACCESS_FROM_ALL;
-        if (phdr->p_flags & PF_W) {
-            flags |= PAGING_IS_WRITABLE;
+        if (segment->phdr.p_flags & PF_W) {
+            res = process_map_elf_private(process, segment, flags | PAGING_IS_WRITABLE);
+            if (ISERR(res)) {
+                break;
+            }
+            continue;
         }
-        res = paging_map_to(process->task->page_directory, paging_align_to_lower_page((void*)phdr->p_vaddr), paging_align_to_lower_page(phdr_phys_address), paging_align_address(phdr_phys_address+phdr->p_memsz), flags);
+
+        // read only segments map the cached image itself
+        res = paging_map_range(process->task->page_directory, paging_align_to_lower_page((void*)segment->phdr.p_vaddr), segment->mem, segment->total_pages, flags);
         if (ISERR(res)) {
             break;
         }
+
+        frame_ref_contiguous(segment->mem, segment->total_pages);
     }
     return res;
 }
@@ -369,14 +546,124 @@ int process_map_memory(struct process* process) {
         default:
             panic("Unknown process filetype\n");
     }
-    res = process_map_binary(process);
+
+    if (ISERR(res)) {
+        return res;
+    }
+
+    // the clock page is shared by everyone, it's only ever written by the kernel
+    res = paging_map(process->task->page_directory, (void*)BENOS_PROGRAM_VIRTUAL_CLOCK_PAGE_ADDRESS, clock_page_frame(), PAGING_IS_PRESENT | PAGING_ACCESS_FROM_ALL);
+    if (ISERR(res)) {
+        return res;
+    }
+
+    frame_ref(clock_page_frame());
+
+    // the stack isn't mapped up front, its pages come from the page fault handler
+    return res;
+}
+
+static bool process_is_stack_address(struct process* process, void* virt) {
+    return virt >= (void*)BENOS_PROGRAM_VIRTUAL_STACK_ADDRESS_START - process->stack_limit && virt < (void*)BENOS_PROGRAM_VIRTUAL_STACK_ADDRESS_START;
+}
+
+// the stack grows into any page above the guard page, as long as the access is near the stack pointer
+static bool process_is_stack_growth(struct process* process, void* virt) {
+    return process_is_stack_address(process, virt) && virt + BENOS_USER_STACK_FAULT_SLACK >= (void*)process->task->registers.esp;
+}
+
+// paging flags for a page that's filled in on first touch, -EFAULT if virt isn't in such a region
+static int process_demand_page_flags(struct process* process, void* virt) {
+    if (process_is_stack_growth(process, virt)) {
+        return PAGING_IS_WRITABLE;
+    }
+
+    if (virt >= (void*)BENOS_PROGRAM_VIRTUAL_HEAP_ADDRESS && virt < process->brk) {
+        return PAGING_IS_WRITABLE;
+    }
+
+    if (process_get_allocation_containing(process, virt)) {
+        return PAGING_IS_WRITABLE;
+    }
+
+    if (process->filetype == PROCESS_FILETYPE_ELF) {
+        for (int i = 0; i < elf_total_segments(process->elf); i++) {
+            struct elf32_phdr* phdr = &elf_segment(process->elf, i)->phdr;
+            void* start = 0;
+            void* end = 0;
+            process_elf_bss_range(phdr, &start, &end);
+            if (virt >= start && virt < end) {
+                return (phdr->p_flags & PF_W) ? PAGING_IS_WRITABLE : 0;
+            }
+        }
+    }
+
+    return -EFAULT;
+}
+
+// first write to a page shared since a fork, the last process still using the frame can just take it over
+static int process_copy_on_write(struct process* process, void* page, uint32_t entry) {
+    void* frame = (void*)(entry & 0xFFFFF000);
+    uint32_t flags = (entry & 0xFFF & ~PAGING_IS_COW) | PAGING_IS_WRITABLE;
+    if (frame_refcount(frame) == 1) {
+        return paging_set(process->task->page_directory->directory_entry, page, (uint32_t)frame | flags);
+    }
+
+    void* copy = frame_alloc();
+    if (!copy) {
+        return -ENOMEM;
+    }
+
+    memcpy(copy, frame, PAGING_PAGE_SIZE);
+    int res = paging_set(process->task->page_directory->directory_entry, page, (uint32_t)copy | flags);
     if (res < 0) {
-        goto out;
+        frame_free(copy);
+        return res;
     }
 
-    paging_map_to(process->task->page_directory, (void*)BENOS_PROGRAM_VIRTUAL_STACK_ADDRESS_END, process->stack, paging_align_address(process->stack + BENOS_USER_PROGRAM_STACK_SIZE), PAGING_IS_PRESENT | PAGING_ACCESS_FROM_ALL | PAGING_IS_WRITABLE);
+    // drops this process's reference on the shared frame
+    frame_free(frame);
+    return res;
+}
+
+// maps a zeroed frame for a page the process reserved but never touched, or copies a shared page on write
+int process_handle_page_fault(struct process* process, void* virt, uint32_t error) {
+    if (!process) {
+        return -EFAULT;
+    }
+
+    // untouched pages still point at the kernel's supervisor only identity map
+    uint32_t entry = paging_get(process->task->page_directory->directory_entry, paging_align_to_lower_page(virt));
+    if (entry & PAGING_ACCESS_FROM_ALL) {
+        if ((entry & PAGING_IS_PRESENT) && (entry & PAGING_IS_COW) && (error & PAGING_FAULT_WRITE)) {
+            return process_copy_on_write(process, paging_align_to_lower_page(virt), entry);
+        }
+
+        // the page is there, the access itself isn't allowed
+        return -EFAULT;
+    }
+
+    int flags = process_demand_page_flags(process, virt);
+    if (flags < 0) {
+        return flags;
+    }
+
+    void* frame = frame_zalloc();
+    if (!frame) {
+        return -ENOMEM;
+    }
+
+    void* page = paging_align_to_lower_page(virt);
+    int res = paging_map(process->task->page_directory, page, frame, flags | PAGING_IS_PRESENT | PAGING_ACCESS_FROM_ALL);
+    if (res < 0) {
+        frame_free(frame);
+        return res;
+    }
+
+    if (process_is_stack_address(process, page) && page < process->stack_bottom) {
+        process->stack_bottom = page;
+    }
 
-out:
     return res;
 }
 
@@ -419,15 +706,14 @@ int process_load_switch(const char* fname, struct process** process) {
 int process_load_for_slot(const char* fname, struct process** process, int process_slot) {
     int res = 0;
     struct task* task = 0;
-    struct process* _process;
-    void* program_stack_ptr = 0;
+    struct process* _process = 0;
 
     if (process_get(process_slot) != 0) {
         res = -EISTKN;
         goto out;
     }
 
-    _process = kzalloc(sizeof(struct process));
+    _process = kmem_cache_zalloc(&process_cache);
     if (!_process) {
         res = -ENOMEM;
         goto out;
@@ -439,17 +725,14 @@ int process_load_for_slot(const char* fname, struct process** process, int proce
         goto out;
     }
 
-    program_stack_ptr = kzalloc(BENOS_USER_PROGRAM_STACK_SIZE);
-
-    if (!program_stack_ptr) {
-        res = -ENOMEM;
-        goto out;
-    }
-
     strncpy(_process->filename, fname, sizeof(_process->filename));
-    _process->stack = program_stack_ptr;
     _process->id = process_slot;
 
+    // nothing of the stack is mapped yet
+    _process->stack_bottom = (void*)BENOS_PROGRAM_VIRTUAL_STACK_ADDRESS_START;
+    _process->stack_limit = BENOS_USER_PROGRAM_STACK_SIZE;
+    _process->brk = (void*)BENOS_PROGRAM_VIRTUAL_HEAP_ADDRESS;
+
     // create a new task
     task = task_new(_process);
 
@@ -465,19 +748,110 @@ int process_load_for_slot(const char* fname, struct process** process, int proce
         goto out;
     }
 
+    // argc is 0 until someone injects arguments
+    res = process_inject_args(_process, 0);
+    if (res < 0) {
+        goto out;
+    }
+
     *process = _process;
 
     // add process to array
-    process[process_slot] = _process;
+    processes[process_slot] = _process;
 
 
 out:
-    if (ISERR(res)) {
-        if (_process && _process->task) {
+    if (ISERR(res) && _process) {
+        if (_process->task) {
+            paging_free_user_frames(_process->task->page_directory);
             task_free(_process->task);
         }
 
-        kfree(_process);
+        process_free_progran_data(_process);
+        process_free_allocations(_process);
+        kmem_cache_free(&process_cache, _process);
+    }
+    return res;
+}
+
+// the image stays loaded once, every process using it holds its own reference
+static void process_share_program_data(struct process* from, struct process* to) {
+    to->filetype = from->filetype;
+    to->size = from->size;
+    switch(from->filetype) {
+        case PROCESS_FILETYPE_ELF:
+            to->elf = elf_ref(from->elf);
+            break;
+        case PROCESS_FILETYPE_BINARY:
+            to->ptr = from->ptr;
+            frame_ref_contiguous(from->ptr, frame_size_to_frames(from->size));
+            break;
+    }
+}
+
+// a copy of parent that shares all of its memory copy on write, the child returns 0 from the system call
+int process_fork(struct process* parent, struct process** child_out) {
+    int res = 0;
+    struct task* task = 0;
+    struct process* child = 0;
+    int process_slot = process_get_free_slot();
+    if (process_slot < 0) {
+        res = -EISTKN;
+        goto out;
+    }
+
+    child = kmem_cache_zalloc(&process_cache);
+    if (!child) {
+        res = -ENOMEM;
+        goto out;
+    }
+
+    process_init(child);
+    strncpy(child->filename, parent->filename, sizeof(child->filename));
+    child->id = process_slot;
+    process_share_program_data(parent, child);
+
+    // the same addresses are reserved in the child, their pages come with the directory
+    res = process_copy_allocations(parent, child);
+    if (res < 0) {
+        goto out;
+    }
+
+    child->stack_bottom = parent->stack_bottom;
+    child->stack_limit = parent->stack_limit;
+    child->brk = parent->brk;
+    child->args = parent->args;
+
+    task = task_new(child);
+    if (ISERR(task)) {
+        res = ERROR_I(task);
+        goto out;
+    }
+
+    child->task = task;
+    sched_nice(task, parent->task->nice);
+    res = paging_share_copy_on_write(parent->task->page_directory, task->page_directory);
+    if (res < 0) {
+        goto out;
+    }
+
+    // carries on right after the system call that forked it
+    task->registers = parent->task->registers;
+    task->registers.eax = 0;
+
+    processes[process_slot] = child;
+    *child_out = child;
+
+out:
+    if (ISERR(res) && child) {
+        if (child->task) {
+            paging_free_user_frames(child->task->page_directory);
+            task_free(child->task);
+        }
+
+        process_free_progran_data(child);
+        process_free_allocations(child);
+        kmem_cache_free(&process_cache, child);
     }
     return res;
-}
\ No newline at end of file
+}
@@ -5,6 +5,7 @@
 #include <stdbool.h>
 #include "../config.h"
 #include "task.h"
+#include "sched.h"
 
 #define PROCESS_FILETYPE_ELF 0
 #define PROCESS_FILETYPE_BINARY 1
@@ -35,8 +36,10 @@ struct process {
     // main process task
     struct task* task;
 
-    // memory (malloc)  allocations of the process
-    struct process_allocation allocations[BENOS_MAX_PROGRAM_ALLOCATIONS];
+    // memory (malloc) allocations of the process, sorted by address so lookups are a binary search
+    struct process_allocation* allocations;
+    int total_allocations;
+    int max_allocations;
 
     PROCESS_FILETYPE filetype;
     union
@@ -46,16 +49,25 @@ struct process {
         struct elf_file* elf;
     };
 
-    // the physical pointer to the stack
-    void* stack;
-
     // size of data pointed to by ptr
     uint32_t size;
 
+    // end of the program break, [BENOS_PROGRAM_VIRTUAL_HEAP_ADDRESS, brk) is mapped on first touch
+    void* brk;
+
+    // lowest stack page the process touched, the stack is mapped from there up to the top of the stack window
+    void* stack_bottom;
+
+    // how far the stack may grow below the top of the stack window
+    uint32_t stack_limit;
+
     struct keyboard_buffer {
         char buffer[BENOS_KEYBOARD_BUFFER_SIZE];
         int tail;
         int head;
+
+        // tasks asleep until a key comes in
+        struct wait_queue waiters;
     } keyboard;
 
     //arguments of the process
@@ -70,6 +82,9 @@ struct process* process_current();
 struct process* process_get(int process_id);
 void* process_malloc(struct process* process, size_t size);
 void process_free(struct process* process, void* ptr);
+void* process_sbrk(struct process* process, int increment);
+int process_handle_page_fault(struct process* process, void* virt, uint32_t error);
+int process_fork(struct process* parent, struct process** child_out);
 
 void process_get_args(struct process* process, int* argc, char*** argv);
 int process_inject_args(struct process* process, struct command_arg* root_arg);
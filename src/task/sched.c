@@ -0,0 +1,272 @@
+#include "sched.h"
+#include "task.h"
+#include "../idt/timer.h"
+
+// multi level feedback queues: level 0 runs first, tasks of the same level take turns
+// a task starts at the level of its nice, every time it uses up its time slice it drops a level (down to
+// SCHED_SINK_LEVELS below its nice), so cpu bound programs sink below the ones that mostly wait
+// every BENOS_SCHED_BOOST_TICKS all tasks go back to their base level, so the low levels never starve
+// a task waiting for something sleeps on a wait queue instead, it's in no run queue until it's woken up
+
+#define SCHED_SINK_LEVELS (BENOS_SCHED_LEVELS - BENOS_SCHED_MAX_NICE - 1)
+
+struct sched_queue {
+    struct task* head;
+    struct task* tail;
+};
+
+static struct sched_queue sched_queues[BENOS_SCHED_LEVELS];
+
+// bit n is set while level n has a task waiting to run
+static uint32_t sched_ready = 0;
+
+static uint32_t sched_ticks = 0;
+
+// time slice in clock ticks, twice as long for every level the task sank
+static uint32_t sched_quantum(struct task* task) {
+    return BENOS_SCHED_QUANTUM_TICKS << (task->priority - task->nice);
+}
+
+// waits at the end of its level, keeps whatever is left of its time slice
+void sched_enqueue(struct task* task) {
+    // the idle task only runs when no queue has a task
+    if (task->state == TASK_STATE_READY || task->priority == SCHED_IDLE_LEVEL) {
+        return;
+    }
+
+    struct sched_queue* queue = &sched_queues[task->priority];
+    task->run_next = 0;
+    task->run_prev = queue->tail;
+    if (queue->tail) {
+        queue->tail->run_next = task;
+    } else {
+        queue->head = task;
+    }
+
+    queue->tail = task;
+    task->state = TASK_STATE_READY;
+    sched_ready |= 1 << task->priority;
+}
+
+static void sched_dequeue(struct task* task) {
+    if (task->state != TASK_STATE_READY) {
+        return;
+    }
+
+    struct sched_queue* queue = &sched_queues[task->priority];
+    if (task->run_prev) {
+        task->run_prev->run_next = task->run_next;
+    } else {
+        queue->head = task->run_next;
+    }
+
+    if (task->run_next) {
+        task->run_next->run_prev = task->run_prev;
+    } else {
+        queue->tail = task->run_prev;
+    }
+
+    task->run_next = 0;
+    task->run_prev = 0;
+    task->state = TASK_STATE_STOPPED;
+    if (!queue->head) {
+        sched_ready &= ~(1 << task->priority);
+    }
+}
+
+// new tasks start at their base level
+void sched_add(struct task* task) {
+    task->priority = task->nice;
+    task->ticks_left = 0;
+    sched_enqueue(task);
+}
+
+static void sched_wait_queue_remove(struct task* task) {
+    struct wait_queue* queue = task->wait_queue;
+    if (task->wait_prev) {
+        task->wait_prev->wait_next = task->wait_next;
+    } else {
+        queue->head = task->wait_next;
+    }
+
+    if (task->wait_next) {
+        task->wait_next->wait_prev = task->wait_prev;
+    } else {
+        queue->tail = task->wait_prev;
+    }
+
+    task->wait_queue = 0;
+    task->wait_next = 0;
+    task->wait_prev = 0;
+}
+
+void sched_remove(struct task* task) {
+    sched_dequeue(task);
+    if (task->state == TASK_STATE_BLOCKED && task->wait_queue) {
+        sched_wait_queue_remove(task);
+    }
+
+    timer_cancel(&task->wait_timer);
+    task->state = TASK_STATE_STOPPED;
+}
+
+// first task of the highest level that has one, 0 if nothing is ready
+struct task* sched_pick() {
+    if (!sched_ready) {
+        return 0;
+    }
+
+    return sched_queues[__builtin_ctz(sched_ready)].head;
+}
+
+// the task is about to run, it leaves its queue and gets a new time slice if it used up the last one
+void sched_start(struct task* task) {
+    sched_dequeue(task);
+    task->state = TASK_STATE_RUNNING;
+    if (!task->ticks_left) {
+        task->ticks_left = sched_quantum(task);
+    }
+}
+
+// moves the task to another level with a full time slice of that level
+static void sched_set_priority(struct task* task, int priority) {
+    bool queued = task->state == TASK_STATE_READY;
+    sched_dequeue(task);
+    task->priority = priority;
+    task->ticks_left = sched_quantum(task);
+    if (queued) {
+        sched_enqueue(task);
+    }
+}
+
+// everyone goes back to their base level
+static void sched_boost(struct task* current) {
+    for (int level = 1; level < BENOS_SCHED_LEVELS; level++) {
+        struct task* task = sched_queues[level].head;
+        while (task) {
+            // a task only ever moves to a level above this one, so the walk doesn't see it again
+            struct task* next = task->run_next;
+            if (task->priority > task->nice) {
+                sched_set_priority(task, task->nice);
+            }
+            task = next;
+        }
+    }
+
+    if (current && current->priority != SCHED_IDLE_LEVEL) {
+        sched_set_priority(current, current->nice);
+    }
+}
+
+// accounts one clock tick to the running task, true if it should make way for another task
+bool sched_tick(struct task* current) {
+    sched_ticks++;
+    if (sched_ticks % BENOS_SCHED_BOOST_TICKS == 0) {
+        sched_boost(current);
+    }
+
+    if (!current) {
+        return true;
+    }
+
+    if (current->priority == SCHED_IDLE_LEVEL) {
+        return sched_should_preempt(current);
+    }
+
+    if (current->ticks_left) {
+        current->ticks_left--;
+    }
+
+    if (!current->ticks_left) {
+        if (current->priority - current->nice < SCHED_SINK_LEVELS) {
+            current->priority++;
+        }
+        return true;
+    }
+
+    return sched_should_preempt(current);
+}
+
+// true if a task of a higher level than the running one is waiting, the idle task makes way for anyone
+bool sched_should_preempt(struct task* current) {
+    return current && (sched_ready & ((1 << current->priority) - 1));
+}
+
+// lets the other tasks of the same level (or a higher one) run, the time slice keeps counting down so a task that
+// polls in a loop still drops like any other busy task
+void sched_yield() {
+    task_next();
+}
+
+// moves the base level of the task, 0 is the most important, returns the new base level
+int sched_nice(struct task* task, int increment) {
+    int nice = task->nice + increment;
+    if (nice < 0) {
+        nice = 0;
+    }
+
+    if (nice > BENOS_SCHED_MAX_NICE) {
+        nice = BENOS_SCHED_MAX_NICE;
+    }
+
+    // starts over at the new base level
+    task->nice = nice;
+    sched_set_priority(task, nice);
+    return nice;
+}
+
+// a blocked task goes back to its run queue
+static void sched_wake(struct task* task) {
+    if (task->wait_queue) {
+        sched_wait_queue_remove(task);
+    }
+
+    timer_cancel(&task->wait_timer);
+    task->state = TASK_STATE_STOPPED;
+    sched_enqueue(task);
+}
+
+static void sched_wait_timeout(struct timer* timer) {
+    struct task* task = timer->data;
+    task->wait_timed_out = true;
+    sched_wake(task);
+}
+
+// the running task sleeps on the queue until sched_wake_all, the next task runs right away (doesn't return)
+void sched_sleep(struct wait_queue* queue) {
+    sched_sleep_timeout(queue, 0);
+}
+
+// like sched_sleep but also wakes up after ticks clock ticks (0 for never), without a queue only the timeout wakes it
+void sched_sleep_timeout(struct wait_queue* queue, uint32_t ticks) {
+    struct task* task = task_current();
+    task->state = TASK_STATE_BLOCKED;
+    task->wait_timed_out = false;
+    if (queue) {
+        task->wait_queue = queue;
+        task->wait_next = 0;
+        task->wait_prev = queue->tail;
+        if (queue->tail) {
+            queue->tail->wait_next = task;
+        } else {
+            queue->head = task;
+        }
+
+        queue->tail = task;
+    }
+
+    if (ticks) {
+        task->wait_timer.function = sched_wait_timeout;
+        task->wait_timer.data = task;
+        timer_add(&task->wait_timer, ticks);
+    }
+
+    task_next();
+}
+
+// every task asleep on the queue goes back to its run queue, safe to call from an interrupt handler
+void sched_wake_all(struct wait_queue* queue) {
+    while (queue->head) {
+        sched_wake(queue->head);
+    }
+}
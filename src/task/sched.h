@@ -0,0 +1,32 @@
+#ifndef SCHED_H
+#define SCHED_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "../config.h"
+
+struct task;
+
+// tasks asleep until something they wait for happens (a key press, ...)
+struct wait_queue {
+    struct task* head;
+    struct task* tail;
+};
+
+// level of the idle task, below every run queue
+#define SCHED_IDLE_LEVEL BENOS_SCHED_LEVELS
+
+void sched_add(struct task* task);
+void sched_remove(struct task* task);
+void sched_enqueue(struct task* task);
+struct task* sched_pick();
+void sched_start(struct task* task);
+bool sched_tick(struct task* current);
+bool sched_should_preempt(struct task* current);
+void sched_yield();
+int sched_nice(struct task* task, int increment);
+void sched_sleep(struct wait_queue* queue);
+void sched_sleep_timeout(struct wait_queue* queue, uint32_t ticks);
+void sched_wake_all(struct wait_queue* queue);
+
+#endif
@@ -4,6 +4,9 @@ section .asm
 global restore_general_purpose_registers
 global task_return
 global user_registers
+global task_idle
+
+extern task_idle_work
 
 ; void task_return(struct registers* regs) <- regs is getting passed
 task_return:
@@ -68,4 +71,20 @@ user_registers:
     mov es, ax
     mov fs, ax
     mov gs, ax
-    ret
\ No newline at end of file
+    ret
+
+; void task_idle()
+; entered through task_return like any task, an interrupt that finds nothing else to run returns to the hlt
+task_idle:
+    ; task_return leaves the top of the idle stack in ebp (iret keeps the old esp within ring 0)
+    mov esp, ebp
+.loop:
+    cli
+    call task_idle_work
+    test al, al
+    ; interrupts get in between batches, a task they wake up is switched to right away
+    sti
+    jnz .loop
+    ; the clock is tickless while idle, so this sleeps until the next device interrupt or the pit's one shot count
+    hlt
+    jmp .loop
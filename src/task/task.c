@@ -3,12 +3,16 @@
 #include "../status.h"
 #include "../memory/paging/paging.h"
 #include "../memory/heap/kheap.h"
+#include "../memory/heap/slab.h"
+#include "../memory/frame.h"
 #include "../memory/memory.h"
 #include "../task/process.h"
 #include "../idt/idt.h"
 #include "../memory/paging/paging.h"
 #include "../string/string.h"
 #include "../loader/formats/elfloader.h"
+#include "sched.h"
+#include "../idt/timer.h"
 
 // current running task
 struct task* current_task = 0;
@@ -17,6 +21,14 @@ struct task* current_task = 0;
 struct task* task_tail = 0;
 struct task* task_head = 0;
 
+static struct kmem_cache task_cache = {.name = "task", .size = sizeof(struct task)};
+
+// runs in ring 0 whenever no task is ready, never in a run queue and starts over every time it's switched to
+static struct task idle_task;
+static uint8_t idle_stack[BENOS_IDLE_STACK_SIZE] __attribute__((aligned(16)));
+
+extern void task_idle();
+
 int task_init(struct task* task, struct process* process);
 
 struct task* task_current() {
@@ -25,7 +37,7 @@ struct task* task_current() {
 
 struct task* task_new(struct process* process) {
     int res = 0;
-    struct task* task = kzalloc(sizeof(struct task));
+    struct task* task = kmem_cache_zalloc(&task_cache);
     if (!task) {
         res = -ENOMEM;
         goto out;
@@ -40,12 +52,13 @@ struct task* task_new(struct process* process) {
         task_head = task;
         task_tail = task;
         current_task = task;
-        goto out;
+    } else {
+        task_tail->next = task;
+        task->prev = task_tail;
+        task_tail = task;
     }
 
-    task_tail->next = task;
-    task->prev = task_tail;
-    task_tail = task;
+    sched_add(task);
 
 out:
     if (ISERR(res)) {
@@ -55,20 +68,16 @@ out:
     return task;
 }
 
-struct task* task_get_next() {
-    if (!current_task->next) {
-        return task_head;
-    }
-
-    return current_task->next;
-}
-
 static void task_list_remove(struct task* task) {
 
     if (task->prev) {
         task->prev->next = task->next;
     }
 
+    if (task->next) {
+        task->next->prev = task->prev;
+    }
+
     if (task == task_head) {
         task_head = task->next;
     }
@@ -77,24 +86,31 @@ static void task_list_remove(struct task* task) {
         task_tail = task->prev;
     }
 
+    // the scheduler picks whoever runs next
     if (task == current_task) {
-        current_task = task_get_next();
+        current_task = 0;
     }
 }
 
 int task_free(struct task* task) {
     paging_free_4gb(task->page_directory);
+    sched_remove(task);
     task_list_remove(task);
 
     // finally free the task data
-    kfree(task);
+    kmem_cache_free(&task_cache, task);
     return 0;
 }
 
 void task_next() {
-    struct task* next_task = task_get_next();
+    // a task that went to sleep or exited doesn't go back to its run queue
+    if (current_task && current_task->state == TASK_STATE_RUNNING) {
+        sched_enqueue(current_task);
+    }
+
+    struct task* next_task = sched_pick();
     if (!next_task) {
-        panic("No more tasks to run!\n");
+        next_task = &idle_task;
     }
 
     task_switch(next_task);
@@ -102,7 +118,16 @@ void task_next() {
 }
 
 int task_switch(struct task* task) {
+    // the task that ran so far waits in its run queue again
+    if (current_task && current_task != task && current_task->state == TASK_STATE_RUNNING) {
+        sched_enqueue(current_task);
+    }
+
+    sched_start(task);
     current_task = task;
+
+    // clock ticks only matter while another task waits for its turn
+    timer_set_tickless(!sched_pick());
     paging_switch(task->page_directory);
     return 0;
 }
@@ -124,39 +149,95 @@ void task_save_state(struct task* task, struct interrupt_frame* frame) {
 
 }
 
-int copy_string_from_task(struct task* task, void* virt, void* phys, int max) {
-    if (max >= PAGING_PAGE_SIZE) {
-        return -EINVARG;
+// kernel address a user address of the task resolves to, 0 if the task itself can't access it
+// write breaks up a page shared since a fork first, the kernel's own mapping of the frame would ignore the read only bit
+void* task_user_to_kernel(struct task* task, void* virt, bool write) {
+    uint32_t entry = paging_get(task->page_directory->directory_entry, paging_align_to_lower_page(virt));
+    if (!(entry & PAGING_ACCESS_FROM_ALL) || (write && (entry & PAGING_IS_COW))) {
+        // the task may just not have touched the page yet
+        if (process_handle_page_fault(task->process, virt, PAGING_FAULT_USER | (write ? PAGING_FAULT_WRITE : 0)) < 0) {
+            return 0;
+        }
+        entry = paging_get(task->page_directory->directory_entry, paging_align_to_lower_page(virt));
     }
 
-    int res = 0;
-    char* tmp = kzalloc(max);
-    if (!tmp) {
-        res = -ENOMEM;
-        goto out;
+    if (!(entry & PAGING_IS_PRESENT)) {
+        return 0;
     }
 
-    uint32_t* task_dir = task->page_directory->directory_entry;
-    uint32_t old_entry = paging_get(task_dir, tmp);
-    paging_map(task->page_directory, tmp, tmp, PAGING_IS_WRITABLE | PAGING_IS_PRESENT | PAGING_ACCESS_FROM_ALL);
-    paging_switch(task->page_directory);
-    strncpy(tmp, virt, max);
-    kernel_page();
+    // the kernel's alias of the frame ignores the read only bit, so read only pages (shared program text, the
+    // clock page) have to be refused here
+    if (write && !(entry & PAGING_IS_WRITABLE)) {
+        return 0;
+    }
+
+    return (void*)((entry & 0xFFFFF000) + ((uint32_t)virt % PAGING_PAGE_SIZE));
+}
 
-    res = paging_set(task_dir, tmp, old_entry);
-    if (res < 0) {
-        res = -EIO;
-        goto out_free;
+// the user memory helpers below go through the task's page tables a page at a time, no directory switch,
+// no temporary mapping, and untouched or shared pages are faulted in like the task would
+
+int copy_from_user(struct task* task, void* dst, void* user_src, size_t size) {
+    while (size > 0) {
+        void* src = task_user_to_kernel(task, user_src, false);
+        if (!src) {
+            return -EFAULT;
+        }
+
+        size_t left_in_page = PAGING_PAGE_SIZE - ((uint32_t)user_src % PAGING_PAGE_SIZE);
+        size_t chunk = size < left_in_page ? size : left_in_page;
+        memcpy(dst, src, chunk);
+        dst += chunk;
+        user_src += chunk;
+        size -= chunk;
     }
 
-    strncpy(phys, tmp, max);
+    return 0;
+}
 
-out_free:
-    kfree(tmp);
+int copy_to_user(struct task* task, void* user_dst, void* src, size_t size) {
+    while (size > 0) {
+        void* dst = task_user_to_kernel(task, user_dst, true);
+        if (!dst) {
+            return -EFAULT;
+        }
+
+        size_t left_in_page = PAGING_PAGE_SIZE - ((uint32_t)user_dst % PAGING_PAGE_SIZE);
+        size_t chunk = size < left_in_page ? size : left_in_page;
+        memcpy(dst, src, chunk);
+        user_dst += chunk;
+        src += chunk;
+        size -= chunk;
+    }
 
-out:
-    return res;
+    return 0;
+}
+
+// copies a string of at most max - 1 characters and terminates it, returns its length
+int strncpy_from_user(struct task* task, char* dst, void* user_src, int max) {
+    if (max <= 0) {
+        return -EINVARG;
+    }
 
+    int i = 0;
+    while (i < max - 1) {
+        char* src = task_user_to_kernel(task, user_src + i, false);
+        if (!src) {
+            dst[i] = 0x00;
+            return -EFAULT;
+        }
+
+        int left_in_page = PAGING_PAGE_SIZE - ((uint32_t)(user_src + i) % PAGING_PAGE_SIZE);
+        for (; left_in_page > 0 && i < max - 1; left_in_page--, i++) {
+            dst[i] = *src++;
+            if (dst[i] == 0x00) {
+                return i;
+            }
+        }
+    }
+
+    dst[i] = 0x00;
+    return i;
 }
 
 void task_current_save_state(struct interrupt_frame* frame) {
@@ -164,7 +245,12 @@ void task_current_save_state(struct interrupt_frame* frame) {
         panic("task_current_save_state(): No current task exists!\n");
     }
 
+    // the idle task always starts over, there's nothing to save (a ring 0 frame has no esp or ss either)
     struct task* task = task_current();
+    if (task == &idle_task) {
+        return;
+    }
+
     task_save_state(task, frame);
 }
 
@@ -180,19 +266,40 @@ int task_page_task(struct task* task) {
     return 0;
 }
 
+static void task_idle_init() {
+    idle_task.page_directory = paging_new_4gb();
+    if (!idle_task.page_directory) {
+        panic("task_idle_init(): No page directory for the idle task\n");
+    }
+
+    idle_task.registers.ip = (uint32_t)task_idle;
+    idle_task.registers.cs = KERNEL_CODE_SELECTOR;
+    idle_task.registers.ss = KERNEL_DATA_SELECTOR;
+
+    // iret doesn't load esp without a ring change, task_idle takes its stack from ebp
+    idle_task.registers.esp = (uint32_t)idle_stack + sizeof(idle_stack);
+    idle_task.registers.ebp = idle_task.registers.esp;
+    idle_task.priority = SCHED_IDLE_LEVEL;
+}
+
+// a batch of what the idle task does between interrupts, called with interrupts off, true if there's more to do
+bool task_idle_work() {
+    return frame_zero_pool_refill(BENOS_ZERO_FRAME_REFILL_BATCH) == BENOS_ZERO_FRAME_REFILL_BATCH;
+}
+
 void task_run_first_ever_task() {
     if (!current_task) {
         panic("task_run_first_ever_task(): No current task exists!\n");
     }
 
-    task_switch(task_head);
-    task_return(&task_head->registers);
+    task_idle_init();
+    task_next();
 }
 
 int task_init(struct task* task, struct process* process) {
     memset(task, 0, sizeof(struct task));
-    // map entire 4gb address space to itself
-    task->page_directory = paging_new_4gb(PAGING_IS_PRESENT | PAGING_ACCESS_FROM_ALL);
+    // starts out with the kernel's map of the entire 4gb address space
+    task->page_directory = paging_new_4gb();
     if (!task->page_directory) {
         return -EIO;
     }
@@ -216,21 +323,11 @@ int task_init(struct task* task, struct process* process) {
 }
 
 void* task_get_stack_item(struct task* task, int index) {
-    void* result = 0;
-
     uint32_t* sp_ptr = (uint32_t*)task->registers.esp;
+    uint32_t item = 0;
+    if (copy_from_user(task, &item, &sp_ptr[index], sizeof(item)) < 0) {
+        return 0;
+    }
 
-    // switch to the task's page directory
-    task_page_task(task);
-
-    result = (void*)sp_ptr[index];
-
-    // switch to the kernel page directory
-    kernel_page();
-
-    return result;
-}
-
-void* task_virt_addr_to_phys(struct task* task, void* virt) {
-    return paging_get_phys_addr(task->page_directory->directory_entry, virt);
+    return (void*)item;
 }
\ No newline at end of file
@@ -3,10 +3,21 @@
 
 #include "../config.h"
 #include "../memory/paging/paging.h"
+#include "../idt/timer.h"
 
 
 struct interrupt_frame;
 
+// not known to the scheduler (new or exiting)
+#define TASK_STATE_STOPPED 0
+// waiting in its run queue
+#define TASK_STATE_READY 1
+#define TASK_STATE_RUNNING 2
+// asleep on a wait queue, a wake up puts it back in its run queue
+#define TASK_STATE_BLOCKED 3
+
+typedef unsigned char TASK_STATE;
+
 struct registers {
     uint32_t edi;
     uint32_t esi;
@@ -24,6 +35,7 @@ struct registers {
 };
 
 struct process;
+struct wait_queue;
 
 struct task {
     // page dir of the task
@@ -41,11 +53,34 @@ struct task {
     // previous task in linked list
     struct task* prev;
 
+    // run queue level, 0 runs first, drops a level whenever the task uses up its time slice
+    int priority;
+
+    // base level the task starts at and goes back to when priorities are boosted
+    int nice;
+
+    // clock ticks left of the current time slice
+    uint32_t ticks_left;
+
+    // only ready tasks are in a run queue, the running task isn't in one
+    TASK_STATE state;
+    struct task* run_next;
+    struct task* run_prev;
+
+    // wait queue of a blocked task
+    struct wait_queue* wait_queue;
+    struct task* wait_next;
+    struct task* wait_prev;
+
+    // wakes a blocked task up when its sleep has a timeout
+    struct timer wait_timer;
+
+    // the last sleep ended because of its timeout, a restarted system call checks this to give up
+    bool wait_timed_out;
 };
 
 struct task* task_new(struct process* process);
 struct task* task_current();
-struct task* task_get_next();
 int task_free(struct task* task);
 
 int task_switch(struct task* task);
@@ -58,9 +93,12 @@ void restore_general_purpose_registers(struct registers* regs);
 void user_registers();
 
 void task_current_save_state(struct interrupt_frame* frame);
-int copy_string_from_task(struct task* task, void* virt, void* phys, int max);
+void* task_user_to_kernel(struct task* task, void* virt, bool write);
+int copy_from_user(struct task* task, void* dst, void* user_src, size_t size);
+int copy_to_user(struct task* task, void* user_dst, void* src, size_t size);
+int strncpy_from_user(struct task* task, char* dst, void* user_src, int max);
 void* task_get_stack_item(struct task* task, int index);
-void* task_virt_addr_to_phys(struct task* task, void* virt);
 void task_next();
+bool task_idle_work();
 
 #endif
\ No newline at end of file